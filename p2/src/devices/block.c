@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include "devices/ide.h"
 #include "threads/malloc.h"
+#include "threads/trace.h"
 
 /* A block device. */
 struct block
@@ -108,7 +109,9 @@ static void check_sector (struct block *block, block_sector_t sector)
 void block_read (struct block *block, block_sector_t sector, void *buffer)
 {
   check_sector (block, sector);
+  TRACE (TRACE_BLOCK_SUBMIT, sector, 0);
   block->ops->read (block->aux, sector, buffer);
+  TRACE (TRACE_BLOCK_COMPLETE, sector, 0);
   block->read_cnt++;
 }
 
@@ -122,7 +125,9 @@ void block_write (struct block *block, block_sector_t sector,
 {
   check_sector (block, sector);
   ASSERT (block->type != BLOCK_FOREIGN);
+  TRACE (TRACE_BLOCK_SUBMIT, sector, 1);
   block->ops->write (block->aux, sector, buffer);
+  TRACE (TRACE_BLOCK_COMPLETE, sector, 1);
   block->write_cnt++;
 }
 
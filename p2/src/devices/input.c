@@ -4,10 +4,12 @@
 #include "devices/serial.h"
 
 /* Stores keys from the keyboard and serial port. */
+#define BUF_SIZE 1024 /* Power of 2. */
+static uint8_t buf[BUF_SIZE];
 static struct intq buffer;
 
 /* Initializes the input buffer. */
-void input_init (void) { intq_init (&buffer); }
+void input_init (void) { intq_init (&buffer, buf, sizeof buf); }
 
 /* Adds a key to the input buffer.
    Interrupts must be off and the buffer must not be full. */
@@ -16,7 +18,7 @@ void input_putc (uint8_t key)
   ASSERT (intr_get_level () == INTR_OFF);
   ASSERT (!intq_full (&buffer));
 
-  intq_putc (&buffer, key);
+  intq_write (&buffer, &key, 1);
   serial_notify ();
 }
 
@@ -24,15 +26,34 @@ void input_putc (uint8_t key)
    If the buffer is empty, waits for a key to be pressed. */
 uint8_t input_getc (void)
 {
-  enum intr_level old_level;
   uint8_t key;
 
+  input_read (&key, 1, true);
+  return key;
+}
+
+/* Removes up to SIZE keys from the input buffer into BUFFER and
+   returns the number removed.  If the buffer is empty, waits for
+   a key to be pressed if BLOCK is true, and otherwise returns 0
+   at once.  Never waits once any key is available, so a read
+   returns as soon as input arrives. */
+size_t input_read (void *buffer_, size_t size, bool block)
+{
+  enum intr_level old_level;
+  size_t cnt;
+
+  if (size == 0)
+    return 0;
+
+  if (block)
+    intq_wait_not_empty (&buffer);
+
   old_level = intr_disable ();
-  key = intq_getc (&buffer);
+  cnt = intq_read (&buffer, buffer_, size);
   serial_notify ();
   intr_set_level (old_level);
 
-  return key;
+  return cnt;
 }
 
 /* Returns true if the input buffer is full,
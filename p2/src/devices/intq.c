@@ -1,76 +1,138 @@
 #include "devices/intq.h"
 #include <debug.h>
+#include <string.h>
 #include "threads/thread.h"
 
-static int next (int pos);
 static void wait (struct intq *q, struct thread **waiter);
 static void signal (struct intq *q, struct thread **waiter);
 
-/* Initializes interrupt queue Q. */
-void intq_init (struct intq *q)
+/* Initializes interrupt queue Q to hold its bytes in the SIZE
+   bytes of BUF.  SIZE must be a power of 2. */
+void intq_init (struct intq *q, void *buf, size_t size)
 {
+  ASSERT (buf != NULL);
+  ASSERT (size > 0 && (size & (size - 1)) == 0);
+
   lock_init (&q->lock);
   q->not_full = q->not_empty = NULL;
+  q->buf = buf;
+  q->size = size;
   q->head = q->tail = 0;
 }
 
+/* Returns the number of bytes in Q. */
+size_t intq_cnt (const struct intq *q) { return q->head - q->tail; }
+
 /* Returns true if Q is empty, false otherwise. */
-bool intq_empty (const struct intq *q)
-{
-  ASSERT (intr_get_level () == INTR_OFF);
-  return q->head == q->tail;
-}
+bool intq_empty (const struct intq *q) { return q->head == q->tail; }
 
 /* Returns true if Q is full, false otherwise. */
-bool intq_full (const struct intq *q)
+bool intq_full (const struct intq *q) { return intq_cnt (q) == q->size; }
+
+/* Removes up to CNT bytes from Q into BUF and returns the number
+   removed, which is 0 if Q is empty.  Copies at most two
+   contiguous runs.  Wakes a thread waiting for Q to become
+   nonfull once Q is no more than half full, so that the waiter
+   refills it in bulk. */
+size_t intq_read (struct intq *q, void *buf_, size_t cnt)
 {
-  ASSERT (intr_get_level () == INTR_OFF);
-  return next (q->head) == q->tail;
+  uint8_t *buf = buf_;
+  size_t avail = q->head - q->tail;
+  size_t ofs = q->tail & (q->size - 1);
+  size_t first;
+
+  if (cnt > avail)
+    cnt = avail;
+  first = cnt < q->size - ofs ? cnt : q->size - ofs;
+  memcpy (buf, q->buf + ofs, first);
+  memcpy (buf + first, q->buf, cnt - first);
+
+  /* Publish the space only after the copy. */
+  barrier ();
+  q->tail += cnt;
+
+  if (q->not_full != NULL && intq_cnt (q) <= q->size / 2)
+    signal (q, &q->not_full);
+  return cnt;
 }
 
-/* Removes a byte from Q and returns it.
-   If Q is empty, sleeps until a byte is added.
-   When called from an interrupt handler, Q must not be empty. */
-uint8_t intq_getc (struct intq *q)
+/* Adds up to CNT bytes from BUF to Q and returns the number
+   added, which is 0 if Q is full.  Copies at most two contiguous
+   runs.  Wakes a thread waiting for Q to become nonempty. */
+size_t intq_write (struct intq *q, const void *buf_, size_t cnt)
 {
-  uint8_t byte;
+  const uint8_t *buf = buf_;
+  size_t room = q->size - (q->head - q->tail);
+  size_t ofs = q->head & (q->size - 1);
+  size_t first;
 
-  ASSERT (intr_get_level () == INTR_OFF);
+  if (cnt > room)
+    cnt = room;
+  first = cnt < q->size - ofs ? cnt : q->size - ofs;
+  memcpy (q->buf + ofs, buf, first);
+  memcpy (q->buf, buf + first, cnt - first);
+
+  /* Publish the data only after the copy. */
+  barrier ();
+  q->head += cnt;
+
+  if (q->not_empty != NULL && cnt > 0)
+    signal (q, &q->not_empty);
+  return cnt;
+}
+
+/* Waits until Q is nonempty.  Must be called from a kernel
+   thread. */
+void intq_wait_not_empty (struct intq *q)
+{
+  enum intr_level old_level = intr_disable ();
   while (intq_empty (q))
     {
-      ASSERT (!intr_context ());
       lock_acquire (&q->lock);
-      wait (q, &q->not_empty);
+      if (intq_empty (q))
+        wait (q, &q->not_empty);
       lock_release (&q->lock);
     }
-
-  byte = q->buf[q->tail];
-  q->tail = next (q->tail);
-  signal (q, &q->not_full);
-  return byte;
+  intr_set_level (old_level);
 }
 
-/* Adds BYTE to the end of Q.
-   If Q is full, sleeps until a byte is removed.
-   When called from an interrupt handler, Q must not be full. */
-void intq_putc (struct intq *q, uint8_t byte)
+/* Waits until Q is nonfull.  Must be called from a kernel
+   thread. */
+void intq_wait_not_full (struct intq *q)
 {
-  ASSERT (intr_get_level () == INTR_OFF);
+  enum intr_level old_level = intr_disable ();
   while (intq_full (q))
     {
-      ASSERT (!intr_context ());
       lock_acquire (&q->lock);
-      wait (q, &q->not_full);
+      if (intq_full (q))
+        wait (q, &q->not_full);
       lock_release (&q->lock);
     }
+  intr_set_level (old_level);
+}
+
+/* Removes a byte from Q and returns it.
+   If Q is empty, sleeps until a byte is added.
+   When called from an interrupt handler, Q must not be empty. */
+uint8_t intq_getc (struct intq *q)
+{
+  uint8_t byte;
 
-  q->buf[q->head] = byte;
-  q->head = next (q->head);
-  signal (q, &q->not_empty);
+  if (intq_empty (q))
+    intq_wait_not_empty (q);
+  intq_read (q, &byte, 1);
+  return byte;
 }
 
-/* Returns the position after POS within an intq. */
-static int next (int pos) { return (pos + 1) % INTQ_BUFSIZE; }
+/* Adds BYTE to the end of Q.
+   If Q is full, sleeps until a byte is removed.
+   When called from an interrupt handler, Q must not be full. */
+void intq_putc (struct intq *q, uint8_t byte)
+{
+  if (intq_full (q))
+    intq_wait_not_full (q);
+  intq_write (q, &byte, 1);
+}
 
 /* WAITER must be the address of Q's not_empty or not_full
    member.  Waits until the given condition is true. */
@@ -91,7 +153,8 @@ static void wait (struct intq *q UNUSED, struct thread **waiter)
    the waiting thread. */
 static void signal (struct intq *q UNUSED, struct thread **waiter)
 {
-  ASSERT (intr_get_level () == INTR_OFF);
+  enum intr_level old_level = intr_disable ();
+
   ASSERT ((waiter == &q->not_empty && !intq_empty (q)) ||
           (waiter == &q->not_full && !intq_full (q)));
 
@@ -100,4 +163,5 @@ static void signal (struct intq *q UNUSED, struct thread **waiter)
       thread_unblock (*waiter);
       *waiter = NULL;
     }
+  intr_set_level (old_level);
 }
@@ -1,24 +1,32 @@
 #ifndef DEVICES_INTQ_H
 #define DEVICES_INTQ_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 
-/* An "interrupt queue", a circular buffer shared between
-   kernel threads and external interrupt handlers.
-
-   Interrupt queue functions can be called from kernel threads or
-   from external interrupt handlers.  Except for intq_init(),
-   interrupts must be off in either case.
-
-   The interrupt queue has the structure of a "monitor".  Locks
-   and condition variables from threads/synch.h cannot be used in
-   this case, as they normally would, because they can only
-   protect kernel threads from one another, not from interrupt
-   handlers. */
-
-/* Queue buffer size, in bytes. */
-#define INTQ_BUFSIZE 64
+/* An "interrupt queue", a circular buffer of bytes shared
+   between kernel threads and external interrupt handlers.
+
+   An interrupt queue has a single producer and a single
+   consumer, one of which is normally an interrupt handler.  The
+   caller supplies the buffer, whose size must be a power of 2,
+   so that queues can serve devices used before malloc() works.
+   Bytes are added and removed in bulk with intq_write() and
+   intq_read(), which take no locks and may be called with
+   interrupts on or off: the producer alone advances HEAD and
+   the consumer alone advances TAIL, each only after copying the
+   data.
+
+   Waiting for the queue to become nonempty or nonfull, with
+   intq_wait_not_empty() or intq_wait_not_full(), is only
+   possible in a kernel thread.  Only one thread may wait for
+   each condition at once.  Locks and condition variables from
+   threads/synch.h cannot be used to wake the waiter, as they
+   normally would, because they can only protect kernel threads
+   from one another, not from interrupt handlers. */
 
 /* A circular queue of bytes. */
 struct intq
@@ -29,14 +37,20 @@ struct intq
   struct thread *not_empty; /* Thread waiting for not-empty condition. */
 
   /* Queue. */
-  uint8_t buf[INTQ_BUFSIZE]; /* Buffer. */
-  int head;                  /* New data is written here. */
-  int tail;                  /* Old data is read here. */
+  uint8_t *buf;         /* Buffer. */
+  size_t size;          /* Buffer size, a power of 2. */
+  size_t head;          /* Number of bytes ever added. */
+  size_t tail;          /* Number of bytes ever removed. */
 };
 
-void intq_init (struct intq *);
+void intq_init (struct intq *, void *buf, size_t size);
+size_t intq_cnt (const struct intq *);
 bool intq_empty (const struct intq *);
 bool intq_full (const struct intq *);
+size_t intq_read (struct intq *, void *, size_t);
+size_t intq_write (struct intq *, const void *, size_t);
+void intq_wait_not_empty (struct intq *);
+void intq_wait_not_full (struct intq *);
 uint8_t intq_getc (struct intq *);
 void intq_putc (struct intq *, uint8_t);
 
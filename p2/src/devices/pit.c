@@ -11,8 +11,10 @@
 #define PIT_PORT_CONTROL 0x43                        /* Control port. */
 #define PIT_PORT_COUNTER(CHANNEL) (0x40 + (CHANNEL)) /* Counter port. */
 
-/* PIT cycles per second. */
-#define PIT_HZ 1193180
+/* Control word commands. */
+#define PIT_READ_BACK 0xc0    /* Read-back command. */
+#define PIT_RB_NO_COUNT 0x20  /* Read-back: don't latch count. */
+#define PIT_STATUS_OUT 0x80   /* Status byte: state of OUT pin. */
 
 /* Configure the given CHANNEL in the PIT.  In a PC, the PIT's
    three output channels are hooked up like this:
@@ -80,3 +82,60 @@ void pit_configure_channel (int channel, int mode, int frequency)
   outb (PIT_PORT_COUNTER (channel), count >> 8);
   intr_set_level (old_level);
 }
+
+/* Starts CHANNEL counting down from COUNT in mode 0, "interrupt
+   on terminal count."  The channel's output drops to 0 and rises
+   to 1 once, COUNT cycles of PIT_HZ later, so channel 0 raises a
+   single timer interrupt instead of a periodic one.  A COUNT of
+   0 is treated as 65536.  Use pit_configure_channel() to return
+   to periodic operation. */
+void pit_start_oneshot (int channel, uint16_t count)
+{
+  enum intr_level old_level;
+
+  ASSERT (channel == 0 || channel == 2);
+
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, (channel << 6) | 0x30);
+  outb (PIT_PORT_COUNTER (channel), count);
+  outb (PIT_PORT_COUNTER (channel), count >> 8);
+  intr_set_level (old_level);
+}
+
+/* Returns the current value of CHANNEL's down-counter. */
+uint16_t pit_read_count (int channel)
+{
+  enum intr_level old_level;
+  uint16_t count;
+
+  ASSERT (channel == 0 || channel == 2);
+
+  /* Latch the counter, so that the two bytes we read belong to
+     the same count, then read it low byte first. */
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, channel << 6);
+  count = inb (PIT_PORT_COUNTER (channel));
+  count |= inb (PIT_PORT_COUNTER (channel)) << 8;
+  intr_set_level (old_level);
+
+  return count;
+}
+
+/* Returns true if CHANNEL's output pin is high.  For a channel
+   started with pit_start_oneshot(), this means its count has
+   run out. */
+bool pit_output_high (int channel)
+{
+  enum intr_level old_level;
+  uint8_t status;
+
+  ASSERT (channel == 0 || channel == 2);
+
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL,
+        PIT_READ_BACK | PIT_RB_NO_COUNT | (1 << (channel + 1)));
+  status = inb (PIT_PORT_COUNTER (channel));
+  intr_set_level (old_level);
+
+  return (status & PIT_STATUS_OUT) != 0;
+}
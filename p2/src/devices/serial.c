@@ -33,6 +33,11 @@
 #define MCR_REG (IO_BASE + 4) /* MODEM Control Register. */
 #define LSR_REG (IO_BASE + 5) /* Line Status Register (read-only). */
 
+/* FIFO Control Register bits. */
+#define FCR_ENABLE 0x01   /* Enable receive and transmit FIFOs. */
+#define FCR_CLEAR_RX 0x02 /* Clear receive FIFO. */
+#define FCR_CLEAR_TX 0x04 /* Clear transmit FIFO. */
+
 /* Interrupt Enable Register bits. */
 #define IER_RECV 0x01 /* Interrupt when data received. */
 #define IER_XMIT 0x02 /* Interrupt when transmit finishes. */
@@ -47,15 +52,32 @@
 /* Line Status Register. */
 #define LSR_DR 0x01   /* Data Ready: received data byte is in RBR. */
 #define LSR_THRE 0x20 /* THR Empty. */
+#define LSR_TEMT 0x40 /* Transmitter empty, including shift register. */
+
+/* Bytes the transmit FIFO holds. */
+#define TX_FIFO_SIZE 16
 
 /* Transmission mode. */
 static enum { UNINIT, POLL, QUEUE } mode;
 
-/* Data to be transmitted. */
+/* Data to be transmitted.  The queue is much larger than the
+   UART's FIFO so that a burst of console output can be queued in
+   one call, and the transmit interrupt refills the whole FIFO
+   each time it empties. */
+#define TXQ_SIZE 4096 /* Power of 2. */
+static uint8_t txq_buf[TXQ_SIZE];
 static struct intq txq;
 
+/* Current value of the interrupt enable register. */
+static uint8_t ier;
+
+/* Bytes the UART accepts per THR-empty, 1 until the FIFO is
+   enabled. */
+static int fifo_size = 1;
+
 static void set_serial (int bps);
 static void putc_poll (uint8_t);
+static void fill_fifo (void);
 static void write_ier (void);
 static intr_handler_func serial_interrupt;
 
@@ -70,7 +92,7 @@ static void init_poll (void)
   outb (FCR_REG, 0);        /* Disable FIFO. */
   set_serial (9600);        /* 9.6 kbps, N-8-1. */
   outb (MCR_REG, MCR_OUT2); /* Required to enable interrupts. */
-  intq_init (&txq);
+  intq_init (&txq, txq_buf, sizeof txq_buf);
   mode = POLL;
 }
 
@@ -86,40 +108,70 @@ void serial_init_queue (void)
   ASSERT (mode == POLL);
 
   intr_register_ext (0x20 + 4, serial_interrupt, "serial");
-  mode = QUEUE;
   old_level = intr_disable ();
+
+  /* Let the last byte sent by polling drain, then enable the
+     FIFOs.  The receive trigger level stays at 1 byte. */
+  while ((inb (LSR_REG) & LSR_TEMT) == 0)
+    continue;
+  outb (FCR_REG, FCR_ENABLE | FCR_CLEAR_RX | FCR_CLEAR_TX);
+  fifo_size = TX_FIFO_SIZE;
+
+  mode = QUEUE;
   write_ier ();
   intr_set_level (old_level);
 }
 
 /* Sends BYTE to the serial port. */
-void serial_putc (uint8_t byte)
+void serial_putc (uint8_t byte) { serial_write (&byte, 1); }
+
+/* Sends the SIZE bytes in BUFFER to the serial port.  Copies as
+   many bytes into the transmit queue at a time as fit.  If the
+   queue fills, waits for the transmit interrupt to make room, or
+   if interrupts are off, sends a FIFO's worth of bytes by
+   polling. */
+void serial_write (const void *buffer, size_t size)
 {
+  const uint8_t *p = buffer;
   enum intr_level old_level = intr_disable ();
 
   if (mode != QUEUE)
     {
       /* If we're not set up for interrupt-driven I/O yet,
-         use dumb polling to transmit a byte. */
+         use dumb polling to transmit. */
       if (mode == UNINIT)
         init_poll ();
-      putc_poll (byte);
+      while (size-- > 0)
+        putc_poll (*p++);
     }
   else
     {
-      /* Otherwise, queue a byte and update the interrupt enable
-         register. */
-      if (old_level == INTR_OFF && intq_full (&txq))
+      while (size > 0)
         {
-          /* Interrupts are off and the transmit queue is full.
-             If we wanted to wait for the queue to empty,
-             we'd have to reenable interrupts.
-             That's impolite, so we'll send a character via
-             polling instead. */
-          putc_poll (intq_getc (&txq));
+          size_t cnt = intq_write (&txq, p, size);
+
+          p += cnt;
+          size -= cnt;
+          if (size > 0)
+            {
+              if (old_level == INTR_ON && !intr_context ())
+                {
+                  /* Wait for the transmit interrupt to drain the
+                     queue. */
+                  write_ier ();
+                  intq_wait_not_full (&txq);
+                }
+              else
+                {
+                  /* Interrupts are off, so waiting would require
+                     reenabling them.  That's impolite, so we'll
+                     make room by polling instead. */
+                  while ((inb (LSR_REG) & LSR_THRE) == 0)
+                    continue;
+                  fill_fifo ();
+                }
+            }
         }
-
-      intq_putc (&txq, byte);
       write_ier ();
     }
 
@@ -132,7 +184,11 @@ void serial_flush (void)
 {
   enum intr_level old_level = intr_disable ();
   while (!intq_empty (&txq))
-    putc_poll (intq_getc (&txq));
+    {
+      while ((inb (LSR_REG) & LSR_THRE) == 0)
+        continue;
+      fill_fifo ();
+    }
   intr_set_level (old_level);
 }
 
@@ -166,24 +222,30 @@ static void set_serial (int bps)
   outb (LCR_REG, LCR_N81);
 }
 
-/* Update interrupt enable register. */
+/* Update interrupt enable register.  Writes the register only
+   if its value changes, because each write is costly under a
+   virtual machine. */
 static void write_ier (void)
 {
-  uint8_t ier = 0;
+  uint8_t new_ier = 0;
 
   ASSERT (intr_get_level () == INTR_OFF);
 
   /* Enable transmit interrupt if we have any characters to
      transmit. */
   if (!intq_empty (&txq))
-    ier |= IER_XMIT;
+    new_ier |= IER_XMIT;
 
   /* Enable receive interrupt if we have room to store any
      characters we receive. */
   if (!input_full ())
-    ier |= IER_RECV;
+    new_ier |= IER_RECV;
 
-  outb (IER_REG, ier);
+  if (new_ier != ier)
+    {
+      ier = new_ier;
+      outb (IER_REG, ier);
+    }
 }
 
 /* Polls the serial port until it's ready,
@@ -197,6 +259,20 @@ static void putc_poll (uint8_t byte)
   outb (THR_REG, byte);
 }
 
+/* Moves up to a FIFO's worth of bytes from the transmit queue
+   to the UART, which must have reported THR empty. */
+static void fill_fifo (void)
+{
+  uint8_t bytes[TX_FIFO_SIZE];
+  size_t cnt, i;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  cnt = intq_read (&txq, bytes, fifo_size);
+  for (i = 0; i < cnt; i++)
+    outb (THR_REG, bytes[i]);
+}
+
 /* Serial interrupt handler. */
 static void serial_interrupt (struct intr_frame *f UNUSED)
 {
@@ -209,10 +285,9 @@ static void serial_interrupt (struct intr_frame *f UNUSED)
   while (!input_full () && (inb (LSR_REG) & LSR_DR) != 0)
     input_putc (inb (RBR_REG));
 
-  /* As long as we have a byte to transmit, and the hardware is
-     ready to accept a byte for transmission, transmit a byte. */
-  while (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0)
-    outb (THR_REG, intq_getc (&txq));
+  /* If the transmit FIFO is empty, refill it from the ring. */
+  if (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0)
+    fill_fifo ();
 
   /* Update interrupt enable register based on queue status. */
   write_ier ();
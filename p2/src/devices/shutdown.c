@@ -5,7 +5,11 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "threads/io.h"
+#include "threads/lockstat.h"
+#include "threads/profile.h"
+#include "threads/trace.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
 #endif
@@ -88,6 +92,8 @@ void shutdown_power_off (void)
 #endif
 
   print_stats ();
+  profile_dump ();
+  trace_dump ();
 
   printf ("Powering off...\n");
   serial_flush ();
@@ -124,6 +130,10 @@ static void print_stats (void)
 {
   timer_print_stats ();
   thread_print_stats ();
+  workqueue_print_stats ();
+#ifdef LOCKSTAT
+  lockstat_print_stats (10);
+#endif
 #ifdef FILESYS
   block_print_stats ();
 #endif
@@ -5,8 +5,10 @@
 #include <stdio.h>
 #include "devices/pit.h"
 #include "threads/interrupt.h"
+#include "threads/profile.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 
 /* See [8254] for hardware details of the 8254 timer chip. */
 
@@ -17,28 +19,71 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
-/* Number of timer ticks since OS booted. */
+/* PIT cycles in one timer tick, rounded as pit_configure_channel()
+   does, and the most whole ticks a single one-shot count can
+   span. */
+#define TICK_CYCLES ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+#define ONESHOT_TICKS_MAX (UINT16_MAX / TICK_CYCLES)
+
+/* Number of timer ticks since OS booted.  Only timer_interrupt()
+   writes it; TICKS_SEQ lets timer_ticks() read all 64 bits
+   consistently without turning interrupts off. */
 static int64_t ticks;
+static struct seqlock ticks_seq;
+
+/* Number of timer interrupts taken since OS booted.  Equal to
+   TICKS unless tickless idle skipped some interrupts. */
+static int64_t interrupt_cnt;
+
+/* If true, the timer stops ticking periodically while the CPU is
+   idle.  Controlled by kernel command-line option "-tickless". */
+bool timer_tickless;
+
+/* If nonzero, busy-wait loops per second to assume instead of
+   calibrating.  Set by kernel command-line option "-calib". */
+unsigned timer_calib_loops;
+
+/* If nonzero, the PIT is running a one-shot count started by
+   timer_idle_enter() instead of ticking periodically, and its
+   interrupt will stand for this many ticks. */
+static int64_t oneshot_ticks;
+
+/* List of threads blocked in timer_sleep(), ordered by
+   ascending wake-up tick so that timer_interrupt() only ever
+   needs to look at the front. */
+static struct list sleep_list;
 
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* Number of timer ticks over which to measure the TSC rate. */
+#define TSC_CALIBRATE_TICKS 4
+
+/* Time-stamp counter cycles per second, or 0 if not yet known.
+   Initialized by timer_calibrate(). */
+static uint64_t tsc_hz;
+
 static intr_handler_func timer_interrupt;
+static list_less_func wake_tick_less;
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
+static void calibrate_tsc (void);
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
    and registers the corresponding interrupt. */
 void timer_init (void)
 {
+  list_init (&sleep_list);
+  seqlock_init (&ticks_seq);
   pit_configure_channel (0, 2, TIMER_FREQ);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Calibrates loops_per_tick and the TSC rate, used to implement
+   brief delays and the nanosecond clock. */
 void timer_calibrate (void)
 {
   unsigned high_bit, test_bit;
@@ -46,31 +91,73 @@ void timer_calibrate (void)
   ASSERT (intr_get_level () == INTR_ON);
   printf ("Calibrating timer...  ");
 
-  /* Approximate loops_per_tick as the largest power-of-two
-     still less than one timer tick. */
-  loops_per_tick = 1u << 10;
-  while (!too_many_loops (loops_per_tick << 1))
+  /* The loop calibration below takes a few dozen ticks.  Skip it
+     if the user already knows the answer from an earlier boot. */
+  if (timer_calib_loops != 0)
     {
-      loops_per_tick <<= 1;
+      loops_per_tick = timer_calib_loops / TIMER_FREQ;
       ASSERT (loops_per_tick != 0);
+      printf ("(preset) ");
+    }
+  else
+    {
+      /* Approximate loops_per_tick as the largest power-of-two
+         still less than one timer tick. */
+      loops_per_tick = 1u << 10;
+      while (!too_many_loops (loops_per_tick << 1))
+        {
+          loops_per_tick <<= 1;
+          ASSERT (loops_per_tick != 0);
+        }
+
+      /* Refine the next 8 bits of loops_per_tick. */
+      high_bit = loops_per_tick;
+      for (test_bit = high_bit >> 1; test_bit != high_bit >> 10;
+           test_bit >>= 1)
+        // if (!too_many_loops (high_bit | test_bit)) 20190206 ans
+        if (!too_many_loops (loops_per_tick | test_bit))
+          loops_per_tick |= test_bit;
     }
 
-  /* Refine the next 8 bits of loops_per_tick. */
-  high_bit = loops_per_tick;
-  for (test_bit = high_bit >> 1; test_bit != high_bit >> 10; test_bit >>= 1)
-    // if (!too_many_loops (high_bit | test_bit)) 20190206 ans
-    if (!too_many_loops (loops_per_tick | test_bit))
-      loops_per_tick |= test_bit;
+  calibrate_tsc ();
 
-  printf ("%'" PRIu64 " loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+  printf ("%'" PRIu64 " loops/s, %'" PRIu64 " TSC cycles/s.\n",
+          (uint64_t) loops_per_tick * TIMER_FREQ, tsc_hz);
+}
+
+/* Measures tsc_hz by counting TSC cycles across
+   TSC_CALIBRATE_TICKS timer ticks. */
+static void calibrate_tsc (void)
+{
+  int64_t start;
+  uint64_t tsc;
+
+  ASSERT (intr_get_level () == INTR_ON);
+
+  /* Start at a tick boundary. */
+  start = ticks;
+  while (ticks == start)
+    barrier ();
+
+  start = ticks;
+  tsc = timer_rdtsc ();
+  while (ticks - start < TSC_CALIBRATE_TICKS)
+    barrier ();
+  tsc_hz = (timer_rdtsc () - tsc) * TIMER_FREQ / TSC_CALIBRATE_TICKS;
 }
 
 /* Returns the number of timer ticks since the OS booted. */
 int64_t timer_ticks (void)
 {
-  enum intr_level old_level = intr_disable ();
-  int64_t t = ticks;
-  intr_set_level (old_level);
+  unsigned start;
+  int64_t t;
+
+  do
+    {
+      start = seqlock_read_begin (&ticks_seq);
+      t = ticks;
+    }
+  while (seqlock_read_retry (&ticks_seq, start));
   return t;
 }
 
@@ -78,15 +165,57 @@ int64_t timer_ticks (void)
    should be a value once returned by timer_ticks(). */
 int64_t timer_elapsed (int64_t then) { return timer_ticks () - then; }
 
+/* Returns a monotonic clock reading in nanoseconds, based on the
+   time-stamp counter.  Before timer_calibrate() has measured the
+   TSC, falls back to timer tick resolution. */
+uint64_t timer_ns (void)
+{
+  if (tsc_hz == 0)
+    return timer_ticks () * (NSEC_PER_SEC / TIMER_FREQ);
+  return timer_tsc_to_ns (timer_rdtsc ());
+}
+
+/* Returns the measured time-stamp counter frequency in Hz, or 0
+   before timer_calibrate() has measured it. */
+uint64_t timer_tsc_hz (void) { return tsc_hz; }
+
+/* Converts CYCLES time-stamp counter cycles to nanoseconds.
+   Returns 0 until timer_calibrate() has measured the TSC. */
+uint64_t timer_tsc_to_ns (uint64_t cycles)
+{
+  uint64_t sec;
+
+  if (tsc_hz == 0)
+    return 0;
+
+  /* Split off whole seconds first so that scaling the remainder
+     by NSEC_PER_SEC cannot overflow.  (We avoid `%' because the
+     kernel's 64-bit remainder routine truncates to 32 bits.) */
+  sec = cycles / tsc_hz;
+  cycles -= sec * tsc_hz;
+  return sec * NSEC_PER_SEC + cycles * NSEC_PER_SEC / tsc_hz;
+}
+
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
-   be turned on. */
+   be turned on.
+
+   The running thread is blocked on sleep_list until
+   timer_interrupt() notices that its wake-up tick has arrived,
+   so a sleeping thread consumes no CPU time at all. */
 void timer_sleep (int64_t ticks)
 {
-  int64_t start = timer_ticks ();
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
 
   ASSERT (intr_get_level () == INTR_ON);
-  while (timer_elapsed (start) < ticks)
-    thread_yield ();
+  if (ticks <= 0)
+    return;
+
+  old_level = intr_disable ();
+  cur->wake_tick = timer_ticks () + ticks;
+  list_insert_ordered (&sleep_list, &cur->elem, wake_tick_less, NULL);
+  thread_block ();
+  intr_set_level (old_level);
 }
 
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
@@ -128,17 +257,130 @@ void timer_udelay (int64_t us) { real_time_delay (us, 1000 * 1000); }
    instead if interrupts are enabled.*/
 void timer_ndelay (int64_t ns) { real_time_delay (ns, 1000 * 1000 * 1000); }
 
+/* Called by the idle thread, with interrupts off, just before it
+   halts the CPU.  In tickless mode, if no sleeping thread is due
+   within the next two ticks, replaces the periodic timer
+   interrupt by a single interrupt at the next sleeper's wake-up
+   tick, or as late as the PIT's 16-bit counter allows.  The
+   interrupt lands on a tick boundary, so the tick rate seen by
+   the rest of the kernel is unchanged. */
+void timer_idle_enter (void)
+{
+  int64_t idle_ticks = ONESHOT_TICKS_MAX;
+  int64_t due_tick;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!timer_tickless || oneshot_ticks != 0)
+    return;
+  if (!list_empty (&sleep_list))
+    {
+      int64_t wake_tick =
+          list_entry (list_front (&sleep_list), struct thread, elem)
+              ->wake_tick;
+      if (wake_tick - ticks < idle_ticks)
+        idle_ticks = wake_tick - ticks;
+    }
+  if (workqueue_next_due (&due_tick) && due_tick - ticks < idle_ticks)
+    idle_ticks = due_tick - ticks;
+  if (idle_ticks < 2)
+    return;
+
+  /* The periodic count in progress gives the cycles left until the
+     next tick boundary; add whole ticks after that. */
+  oneshot_ticks = idle_ticks;
+  pit_start_oneshot (0, pit_read_count (0) + (idle_ticks - 1) * TICK_CYCLES);
+}
+
+/* Called by the scheduler, with interrupts off, when it switches
+   away from the idle thread.  If a one-shot count started by
+   timer_idle_enter() is still running, that is, the idle thread
+   was woken early by some other interrupt, shortens it to end at
+   the next tick boundary, so that the newly running thread gets
+   a fresh tick count and timeslice enforcement within one
+   tick. */
+void timer_idle_exit (void)
+{
+  uint16_t count, to_next;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (oneshot_ticks == 0 || pit_output_high (0))
+    return;
+  count = pit_read_count (0);
+  if (count == 0)
+    return;
+
+  /* The one-shot count ends on a tick boundary, so boundaries lie
+     at multiples of TICK_CYCLES before its end.  Ticks between the
+     next boundary and the end have not happened yet. */
+  to_next = count % TICK_CYCLES != 0 ? count % TICK_CYCLES : TICK_CYCLES;
+  oneshot_ticks -= (count - to_next) / TICK_CYCLES;
+  pit_start_oneshot (0, to_next);
+}
+
 /* Prints timer statistics. */
 void timer_print_stats (void)
 {
-  printf ("Timer: %" PRId64 " ticks\n", timer_ticks ());
+  if (timer_tickless)
+    printf ("Timer: %" PRId64 " ticks, %" PRId64 " interrupts\n",
+            timer_ticks (), interrupt_cnt);
+  else
+    printf ("Timer: %" PRId64 " ticks\n", timer_ticks ());
 }
 
 /* Timer interrupt handler. */
-static void timer_interrupt (struct intr_frame *args UNUSED)
+static void timer_interrupt (struct intr_frame *args)
+{
+  int64_t elapsed = 1;
+
+  interrupt_cnt++;
+  if (profile_enabled ())
+    profile_sample (args);
+  if (oneshot_ticks != 0)
+    {
+      /* A one-shot count from timer_idle_enter() ran out.  Resume
+         periodic ticks, then account for every tick skipped, one
+         at a time, so that per-tick and per-second work in
+         thread_tick() happens exactly as if we had kept ticking. */
+      elapsed = oneshot_ticks;
+      oneshot_ticks = 0;
+      pit_configure_channel (0, 2, TIMER_FREQ);
+    }
+
+  while (elapsed-- > 0)
+    {
+      seqlock_write_begin (&ticks_seq);
+      ticks++;
+      seqlock_write_end (&ticks_seq);
+
+      /* Wake every sleeper whose time has come.  The list is
+         sorted, so we stop at the first thread that must keep
+         sleeping. */
+      while (!list_empty (&sleep_list))
+        {
+          struct thread *t =
+              list_entry (list_front (&sleep_list), struct thread, elem);
+          if (t->wake_tick > ticks)
+            break;
+          list_pop_front (&sleep_list);
+          thread_unblock (t);
+        }
+      workqueue_tick (ticks);
+
+      thread_tick ((args->cs & 3) == 3);
+    }
+}
+
+/* Orders threads on sleep_list by ascending wake-up tick.
+   Threads with equal wake-up ticks keep their insertion order. */
+static bool wake_tick_less (const struct list_elem *a_,
+                            const struct list_elem *b_, void *aux UNUSED)
 {
-  ticks++;
-  thread_tick ();
+  const struct thread *a = list_entry (a_, struct thread, elem);
+  const struct thread *b = list_entry (b_, struct thread, elem);
+
+  return a->wake_tick < b->wake_tick;
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -193,8 +435,7 @@ static void real_time_sleep (int64_t num, int32_t denom)
     }
   else
     {
-      /* Otherwise, use a busy-wait loop for more accurate
-         sub-tick timing. */
+      /* Otherwise, spin for more accurate sub-tick timing. */
       real_time_delay (num, denom);
     }
 }
@@ -202,6 +443,16 @@ static void real_time_sleep (int64_t num, int32_t denom)
 /* Busy-wait for approximately NUM/DENOM seconds. */
 static void real_time_delay (int64_t num, int32_t denom)
 {
+  if (tsc_hz != 0)
+    {
+      /* Spin on the time-stamp counter, which keeps counting
+         while interrupt handlers run, unlike a delay loop. */
+      uint64_t end = timer_rdtsc () + num * tsc_hz / denom;
+      while (timer_rdtsc () < end)
+        barrier ();
+      return;
+    }
+
   /* Scale the numerator and denominator down by 1000 to avoid
      the possibility of overflow. */
   ASSERT (denom % 1000 == 0);
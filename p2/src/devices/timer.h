@@ -2,16 +2,33 @@
 #define DEVICES_TIMER_H
 
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/* Nanoseconds per second. */
+#define NSEC_PER_SEC 1000000000
+
+/* If true, the timer stops ticking periodically while the CPU is
+   idle.  Controlled by kernel command-line option "-tickless". */
+extern bool timer_tickless;
+
+/* If nonzero, busy-wait loops per second to assume instead of
+   calibrating.  Set by kernel command-line option "-calib". */
+extern unsigned timer_calib_loops;
+
 void timer_init (void);
 void timer_calibrate (void);
+void timer_idle_enter (void);
+void timer_idle_exit (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
+uint64_t timer_ns (void);
+uint64_t timer_tsc_hz (void);
+uint64_t timer_tsc_to_ns (uint64_t cycles);
 
 /* Sleep and yield the CPU to other threads. */
 void timer_sleep (int64_t ticks);
@@ -26,4 +43,13 @@ void timer_ndelay (int64_t nanoseconds);
 
 void timer_print_stats (void);
 
+/* Returns the CPU's time-stamp counter, which counts CPU cycles
+   since reset.  See [IA32-v2b] "RDTSC". */
+static inline uint64_t timer_rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A"(tsc));
+  return tsc;
+}
+
 #endif /* devices/timer.h */
@@ -49,11 +49,22 @@ int main (void)
    null-terminated and will not end in a new-line character. */
 static void read_line (char line[], size_t size)
 {
+  static char input[64];
+  static int input_ofs, input_len;
   char *pos = line;
   for (;;)
     {
       char c;
-      read (STDIN_FILENO, &c, 1);
+
+      /* Read as much input as is available at once. */
+      if (input_ofs >= input_len)
+        {
+          input_len = read (STDIN_FILENO, input, sizeof input);
+          input_ofs = 0;
+          if (input_len <= 0)
+            continue;
+        }
+      c = input[input_ofs++];
 
       switch (c)
         {
@@ -6,6 +6,9 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#ifdef USERPROG
+#include "userprog/execcache.h"
+#endif
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -167,6 +170,9 @@ void inode_close (struct inode *inode)
       /* Deallocate blocks if removed. */
       if (inode->removed)
         {
+#ifdef USERPROG
+          exec_cache_invalidate (inode->sector);
+#endif
           free_map_release (inode->sector, 1);
           free_map_release (inode->data.start,
                             bytes_to_sectors (inode->data.length));
@@ -254,6 +260,11 @@ off_t inode_write_at (struct inode *inode, const void *buffer_, off_t size,
   if (inode->deny_write_cnt)
     return 0;
 
+#ifdef USERPROG
+  /* Any cached executable image of this file is now stale. */
+  exec_cache_invalidate (inode->sector);
+#endif
+
   while (size > 0)
     {
       /* Sector to write, starting byte offset within sector. */
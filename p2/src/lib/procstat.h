@@ -0,0 +1,19 @@
+#ifndef __LIB_PROCSTAT_H
+#define __LIB_PROCSTAT_H
+
+/* Per-thread CPU and scheduling statistics, as returned by the
+   procstat system call. */
+
+#include <stdint.h>
+
+struct procstat
+{
+  int64_t user_ticks;            /* Timer ticks taken in user mode. */
+  int64_t kernel_ticks;          /* Timer ticks taken in kernel mode. */
+  uint32_t voluntary_switches;   /* Switches away by blocking/yielding. */
+  uint32_t involuntary_switches; /* Switches away by preemption. */
+  uint64_t runnable_ns;          /* Time ready to run but not running. */
+  uint64_t blocked_ns;           /* Time blocked. */
+};
+
+#endif /* lib/procstat.h */
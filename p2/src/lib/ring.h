@@ -0,0 +1,78 @@
+#ifndef __LIB_RING_H
+#define __LIB_RING_H
+
+/* Submission and completion rings, for making many system calls
+   with one trap into the kernel.
+
+   A process registers a submission ring and a completion ring,
+   both in its own memory, with ring_setup().  To queue an
+   operation it fills in the submission entry at index TAIL mod
+   the ring size and then increments TAIL.  ring_enter() carries
+   out queued operations in order, advancing the submission
+   ring's HEAD, and reports each one's result in a completion
+   entry, advancing the completion ring's TAIL.  The process
+   consumes completions from the completion ring's HEAD.  Indexes
+   run freely and wrap at 2**32. */
+
+#include <stdint.h>
+
+/* Maximum number of entries in a ring. */
+#define RING_MAX_ENTRIES 128
+
+/* Operations. */
+enum ring_op
+{
+  RING_NOP,   /* Do nothing; the result is 0. */
+  RING_READ,  /* read (FD, BUF, LEN). */
+  RING_WRITE, /* write (FD, BUF, LEN). */
+  RING_OPEN,  /* open (BUF); the result is the new descriptor. */
+  RING_CLOSE, /* close (FD); the result is 0. */
+  RING_SEEK   /* seek (FD, LEN); the result is 0. */
+};
+
+/* Submission entry flags. */
+#define RING_LINK 0x01  /* Cancel the rest of the chain on failure. */
+
+/* Result of an operation cancelled because an earlier operation
+   in its chain failed.  A chain is a run of entries each flagged
+   RING_LINK, plus the entry after them.  An operation fails if
+   its result is negative or, for RING_READ and RING_WRITE, not
+   LEN.  A chain must be submitted by a single ring_enter(). */
+#define RING_CANCELED (-2)
+
+/* An operation to carry out. */
+struct ring_sqe
+{
+  uint8_t op;         /* A RING_* operation. */
+  uint8_t flags;      /* RING_* flags. */
+  uint16_t reserved;  /* Must be zero. */
+  int32_t fd;         /* File descriptor. */
+  void *buf;          /* Buffer, or file name for RING_OPEN. */
+  uint32_t len;       /* Byte count, or position for RING_SEEK. */
+  uint32_t user_data; /* Passed through to the completion. */
+};
+
+/* The result of an operation. */
+struct ring_cqe
+{
+  uint32_t user_data; /* From the submission entry. */
+  int32_t result;     /* Result of the operation. */
+};
+
+/* Submission ring. */
+struct ring_sq
+{
+  uint32_t head;              /* Next entry for the kernel. */
+  uint32_t tail;              /* Next entry for the process. */
+  struct ring_sqe entries[];  /* Entries. */
+};
+
+/* Completion ring. */
+struct ring_cq
+{
+  uint32_t head;              /* Next entry for the process. */
+  uint32_t tail;              /* Next entry for the kernel. */
+  struct ring_cqe entries[];  /* Entries. */
+};
+
+#endif /* lib/ring.h */
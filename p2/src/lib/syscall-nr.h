@@ -30,7 +30,16 @@ enum
   SYS_READDIR, /* Reads a directory entry. */
   SYS_ISDIR,   /* Tests if a fd represents a directory. */
   SYS_INUMBER, /* Returns the inode number for a fd. */
-  SYS_STAT  /* Returns information about a file */
+  SYS_STAT,    /* Returns information about a file */
+
+  /* Extensions. */
+  SYS_CLOCK_NS,   /* Read the monotonic nanosecond clock. */
+  SYS_PROCSTAT,   /* Read a process's CPU and scheduling statistics. */
+  SYS_NONBLOCK,   /* Make reads from a file descriptor non-blocking. */
+  SYS_EXECV,      /* Start another process with an argument vector. */
+  SYS_RING_SETUP, /* Register submission and completion rings. */
+  SYS_RING_ENTER, /* Carry out operations queued in the rings. */
+  SYS_LOCKSTAT    /* Print or reset lock contention statistics. */
 };
 
 #endif /* lib/syscall-nr.h */
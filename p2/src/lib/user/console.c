@@ -3,6 +3,65 @@
 #include <syscall.h>
 #include <syscall-nr.h>
 
+/* Standard output buffer.
+
+   printf(), puts(), and putchar() collect standard output here
+   rather than making a system call for every piece of it.
+   Standard output is always the console, so by default it is
+   line buffered: the buffer is written out when a call ends
+   with a new-line in the buffer, when it fills, and before the
+   process reads the console, runs or waits for another process,
+   or exits.  stdout_setbuf() selects full buffering, which
+   writes only when the buffer fills or at those other points,
+   or no buffering. */
+static char stdout_buf[1024];
+static size_t stdout_len;
+static bool stdout_newline;  /* New-line in buffer? */
+static int stdout_mode = _IOLBF;
+
+static void stdout_add (char c);
+static void stdout_done (void);
+
+/* Sets the buffering mode for standard output to MODE, one of
+   _IONBF, _IOLBF, or _IOFBF, and writes out anything buffered. */
+void stdout_setbuf (int mode)
+{
+  ASSERT (mode == _IONBF || mode == _IOLBF || mode == _IOFBF);
+  stdout_flush ();
+  stdout_mode = mode;
+}
+
+/* Writes out anything in the standard output buffer. */
+void stdout_flush (void)
+{
+  size_t len = stdout_len;
+
+  /* Empty the buffer first, because write() flushes it too. */
+  stdout_len = 0;
+  stdout_newline = false;
+  if (len > 0)
+    write (STDOUT_FILENO, stdout_buf, len);
+}
+
+/* Appends C to the standard output buffer, writing the buffer
+   out first if it is full. */
+static void stdout_add (char c)
+{
+  if (stdout_len >= sizeof stdout_buf)
+    stdout_flush ();
+  stdout_buf[stdout_len++] = c;
+  if (c == '\n')
+    stdout_newline = true;
+}
+
+/* Writes out the standard output buffer if the buffering mode
+   calls for it at the end of an output function. */
+static void stdout_done (void)
+{
+  if (stdout_mode == _IONBF || (stdout_mode == _IOLBF && stdout_newline))
+    stdout_flush ();
+}
+
 /* The standard vprintf() function,
    which is like printf() but uses a va_list. */
 int vprintf (const char *format, va_list args)
@@ -27,8 +86,10 @@ int hprintf (int handle, const char *format, ...)
    character. */
 int puts (const char *s)
 {
-  write (STDOUT_FILENO, s, strlen (s));
-  putchar ('\n');
+  while (*s != '\0')
+    stdout_add (*s++);
+  stdout_add ('\n');
+  stdout_done ();
 
   return 0;
 }
@@ -36,8 +97,8 @@ int puts (const char *s)
 /* Writes C to the console. */
 int putchar (int c)
 {
-  char c2 = c;
-  write (STDOUT_FILENO, &c2, 1);
+  stdout_add (c);
+  stdout_done ();
   return c;
 }
 
@@ -53,12 +114,23 @@ struct vhprintf_aux
 static void add_char (char, void *);
 static void flush (struct vhprintf_aux *);
 
+static void add_stdout_char (char, void *);
+
 /* Formats the printf() format specification FORMAT with
    arguments given in ARGS and writes the output to the given
-   HANDLE. */
+   HANDLE.  Output to standard output goes through its buffer. */
 int vhprintf (int handle, const char *format, va_list args)
 {
   struct vhprintf_aux aux;
+
+  if (handle == STDOUT_FILENO)
+    {
+      int char_cnt = 0;
+      __vprintf (format, args, add_stdout_char, &char_cnt);
+      stdout_done ();
+      return char_cnt;
+    }
+
   aux.p = aux.buf;
   aux.char_cnt = 0;
   aux.handle = handle;
@@ -67,6 +139,15 @@ int vhprintf (int handle, const char *format, va_list args)
   return aux.char_cnt;
 }
 
+/* Adds C to the standard output buffer and counts it in
+   *CHAR_CNT_. */
+static void add_stdout_char (char c, void *char_cnt_)
+{
+  int *char_cnt = char_cnt_;
+  stdout_add (c);
+  (*char_cnt)++;
+}
+
 /* Adds C to the buffer in AUX, flushing it if the buffer fills
    up. */
 static void add_char (char c, void *aux_)
@@ -1,4 +1,5 @@
 #include <syscall.h>
+#include <stdio.h>
 #include "../syscall-nr.h"
 
 /* Invokes syscall NUMBER, passing no arguments, and returns the
@@ -54,19 +55,29 @@
 
 void halt (void)
 {
+  stdout_flush ();
   syscall0 (SYS_HALT);
   NOT_REACHED ();
 }
 
 void exit (int status)
 {
+  stdout_flush ();
   syscall1 (SYS_EXIT, status);
   NOT_REACHED ();
 }
 
-pid_t exec (const char *file) { return (pid_t) syscall1 (SYS_EXEC, file); }
+pid_t exec (const char *file)
+{
+  stdout_flush ();
+  return (pid_t) syscall1 (SYS_EXEC, file);
+}
 
-int wait (pid_t pid) { return syscall1 (SYS_WAIT, pid); }
+int wait (pid_t pid)
+{
+  stdout_flush ();
+  return syscall1 (SYS_WAIT, pid);
+}
 
 bool create (const char *file, unsigned initial_size)
 {
@@ -81,11 +92,16 @@ int filesize (int fd) { return syscall1 (SYS_FILESIZE, fd); }
 
 int read (int fd, void *buffer, unsigned size)
 {
+  if (fd == STDIN_FILENO)
+    stdout_flush ();
   return syscall3 (SYS_READ, fd, buffer, size);
 }
 
 int write (int fd, const void *buffer, unsigned size)
 {
+  /* Keep buffered output ahead of this write. */
+  if (fd == STDOUT_FILENO)
+    stdout_flush ();
   return syscall3 (SYS_WRITE, fd, buffer, size);
 }
 
@@ -113,4 +129,47 @@ bool isdir (int fd) { return syscall1 (SYS_ISDIR, fd); }
 
 int inumber (int fd) { return syscall1 (SYS_INUMBER, fd); }
 
-int stat (const char *pathname, void *buf) { return syscall2 (SYS_STAT, pathname, buf); }
\ No newline at end of file
+int stat (const char *pathname, void *buf) { return syscall2 (SYS_STAT, pathname, buf); }
+
+/* Returns the kernel's monotonic clock, in nanoseconds.  The
+   64-bit result comes back in EDX:EAX. */
+uint64_t clock_ns (void)
+{
+  uint64_t ns;
+  asm volatile ("pushl %[number]; int $0x30; addl $4, %%esp"
+                : "=A"(ns)
+                : [number] "i"(SYS_CLOCK_NS)
+                : "memory");
+  return ns;
+}
+
+bool procstat (pid_t pid, struct procstat *stats)
+{
+  return syscall2 (SYS_PROCSTAT, pid, stats);
+}
+
+bool nonblock (int fd, bool nonblocking)
+{
+  return syscall2 (SYS_NONBLOCK, fd, (int) nonblocking);
+}
+
+pid_t execv (const char *file, char *const argv[])
+{
+  stdout_flush ();
+  return (pid_t) syscall2 (SYS_EXECV, file, argv);
+}
+
+bool ring_setup (struct ring_sq *sq, struct ring_cq *cq, unsigned entries)
+{
+  return syscall3 (SYS_RING_SETUP, sq, cq, entries);
+}
+
+int ring_enter (unsigned to_submit)
+{
+  return syscall1 (SYS_RING_ENTER, to_submit);
+}
+
+bool lockstat (unsigned top_cnt, bool reset)
+{
+  return syscall2 (SYS_LOCKSTAT, top_cnt, (int) reset);
+}
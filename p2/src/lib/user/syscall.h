@@ -2,7 +2,10 @@
 #define __LIB_USER_SYSCALL_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <debug.h>
+#include <procstat.h>
+#include <ring.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -43,4 +46,13 @@ bool isdir (int fd);
 int inumber (int fd);
 int stat (const char *pathname, void *buf);
 
+/* Extensions. */
+uint64_t clock_ns (void);
+bool procstat (pid_t, struct procstat *);
+bool nonblock (int fd, bool nonblocking);
+pid_t execv (const char *file, char *const argv[]);
+bool ring_setup (struct ring_sq *, struct ring_cq *, unsigned entries);
+int ring_enter (unsigned to_submit);
+bool lockstat (unsigned top_cnt, bool reset);
+
 #endif /* lib/user/syscall.h */
@@ -0,0 +1,14 @@
+/* Passes an argument vector to a child process with execv,
+   including an empty argument and one with embedded spaces,
+   which exec's command line could not express. */
+
+#include <stddef.h>
+#include <syscall.h>
+#include "tests/main.h"
+
+void test_main (void)
+{
+  char *argv[] = {"child-args", "a", "", "two  spaces!", "b", NULL};
+
+  wait (execv ("child-args", argv));
+}
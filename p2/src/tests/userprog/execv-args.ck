@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(execv-args) begin
+(args) begin
+(args) argc = 5
+(args) argv[0] = 'child-args'
+(args) argv[1] = 'a'
+(args) argv[2] = ''
+(args) argv[3] = 'two  spaces!'
+(args) argv[4] = 'b'
+(args) argv[5] = null
+(args) end
+child-args: exit(0)
+(execv-args) end
+execv-args: exit(0)
+EOF
+pass;
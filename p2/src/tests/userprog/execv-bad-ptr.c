@@ -0,0 +1,15 @@
+/* Passes an argument vector containing an invalid pointer to the
+   execv system call.
+   The process must be terminated with -1 exit code. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void test_main (void)
+{
+  char *argv[] = {"child-args", (char *) 0x20101234, NULL};
+
+  execv ("child-args", argv);
+  fail ("should have exited with -1");
+}
@@ -0,0 +1,17 @@
+/* Passes execv more argument bytes than fit in a page.
+   The execv system call must return -1. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char arg[1024];
+
+void test_main (void)
+{
+  char *argv[] = {arg, arg, arg, arg, arg, NULL};
+
+  memset (arg, 'x', sizeof arg - 1);
+  msg ("execv(\"child-args\"): %d", execv ("child-args", argv));
+}
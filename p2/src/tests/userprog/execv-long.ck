@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(execv-long) begin
+(execv-long) execv("child-args"): -1
+(execv-long) end
+execv-long: exit(0)
+EOF
+pass;
@@ -0,0 +1,13 @@
+/* Runs a child process with execv and an empty argument
+   vector.  The child must see argc = 0 and a null argv[0]. */
+
+#include <stddef.h>
+#include <syscall.h>
+#include "tests/main.h"
+
+void test_main (void)
+{
+  char *argv[] = {NULL};
+
+  wait (execv ("child-args", argv));
+}
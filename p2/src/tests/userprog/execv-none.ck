@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(execv-none) begin
+(args) begin
+(args) argc = 0
+(args) argv[0] = null
+(args) end
+child-args: exit(0)
+(execv-none) end
+execv-none: exit(0)
+EOF
+pass;
@@ -0,0 +1,31 @@
+/* Opens more files than fit in the initial descriptor table,
+   closes one in the middle, and checks that the next open()
+   reuses its descriptor.  Exits with the files still open, which
+   must close them. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 40
+
+void test_main (void)
+{
+  int fds[FILE_CNT];
+  int i;
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      fds[i] = open ("sample.txt");
+      if (fds[i] < 2)
+        fail ("open #%d returned %d", i, fds[i]);
+      if (i > 0 && fds[i] <= fds[i - 1])
+        fail ("open #%d returned %d after %d", i, fds[i], fds[i - 1]);
+    }
+  msg ("opened \"sample.txt\" %d times", FILE_CNT);
+
+  close (fds[FILE_CNT / 2]);
+  msg ("closed a descriptor in the middle");
+  CHECK (open ("sample.txt") == fds[FILE_CNT / 2],
+         "open reuses the closed descriptor");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(open-many) begin
+(open-many) opened "sample.txt" 40 times
+(open-many) closed a descriptor in the middle
+(open-many) open reuses the closed descriptor
+(open-many) end
+open-many: exit(0)
+EOF
+pass;
@@ -0,0 +1,17 @@
+/* Submits a write from an invalid buffer through the rings.
+   The process must be terminated with -1 exit code, as for the
+   write system call. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/userprog/rings.h"
+
+void test_main (void)
+{
+  rings_setup (4);
+  ring_submit (RING_WRITE, 0, STDOUT_FILENO, (void *) 0x20101234, 123, 0);
+  ring_enter (1);
+  fail ("should have exited with -1");
+}
@@ -0,0 +1,36 @@
+/* Passes ring_setup() rings that are not in writable user
+   memory, or have a bad size, and checks ring_enter() without
+   usable rings.  ring_setup() must return false and ring_enter()
+   must return -1. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/userprog/boundary.h"
+#include "tests/userprog/rings.h"
+
+void test_main (void)
+{
+  struct ring_sq *sq;
+
+  CHECK (ring_enter (1) == -1, "ring_enter with no rings");
+  CHECK (!ring_setup (test_sq, test_cq, 3), "ring_setup with 3 entries");
+  CHECK (!ring_setup (test_sq, test_cq, RING_MAX_ENTRIES * 2),
+         "ring_setup with too many entries");
+  CHECK (!ring_setup ((struct ring_sq *) 0xc0000000, test_cq, 4),
+         "ring_setup with kernel submission ring");
+  CHECK (!ring_setup (test_sq, (struct ring_cq *) 0x20101234, 4),
+         "ring_setup with unmapped completion ring");
+  CHECK (!ring_setup ((struct ring_sq *) test_main, test_cq, 4),
+         "ring_setup with read-only submission ring");
+
+  sq = (struct ring_sq *) ((char *) get_bad_boundary () - sizeof *sq);
+  CHECK (!ring_setup (sq, test_cq, 4),
+         "ring_setup with entries past the end of memory");
+
+  rings_setup (4);
+  test_sq->tail = test_sq->head + 5;
+  CHECK (ring_enter (1) == -1, "ring_enter with inconsistent indexes");
+  CHECK (ring_setup (NULL, NULL, 0), "unregister rings");
+  CHECK (ring_enter (1) == -1, "ring_enter after unregistering");
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ring-bad-ptr) begin
+(ring-bad-ptr) ring_enter with no rings
+(ring-bad-ptr) ring_setup with 3 entries
+(ring-bad-ptr) ring_setup with too many entries
+(ring-bad-ptr) ring_setup with kernel submission ring
+(ring-bad-ptr) ring_setup with unmapped completion ring
+(ring-bad-ptr) ring_setup with read-only submission ring
+(ring-bad-ptr) ring_setup with entries past the end of memory
+(ring-bad-ptr) ring_setup (4 entries)
+(ring-bad-ptr) ring_enter with inconsistent indexes
+(ring-bad-ptr) unregister rings
+(ring-bad-ptr) ring_enter after unregistering
+(ring-bad-ptr) end
+ring-bad-ptr: exit(0)
+EOF
+pass;
@@ -0,0 +1,26 @@
+/* Fills the completion ring and checks that ring_enter() stops
+   submitting until completions are consumed. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/userprog/rings.h"
+
+void test_main (void)
+{
+  int i;
+
+  rings_setup (4);
+  for (i = 0; i < 4; i++)
+    ring_submit (RING_NOP, 0, -1, NULL, 0, i);
+  CHECK (ring_enter (4) == 4, "fill the completion ring");
+
+  for (i = 4; i < 6; i++)
+    ring_submit (RING_NOP, 0, -1, NULL, 0, i);
+  CHECK (ring_enter (2) == 0, "ring_enter with completion ring full");
+  CHECK (test_sq->head == 4, "submissions left queued");
+
+  ring_reap ();
+  CHECK (ring_enter (2) == 1, "ring_enter after consuming one completion");
+  CHECK (test_sq->head == 5 && test_cq->tail == 5, "one more submitted");
+}
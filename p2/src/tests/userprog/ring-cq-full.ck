@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ring-cq-full) begin
+(ring-cq-full) ring_setup (4 entries)
+(ring-cq-full) fill the completion ring
+(ring-cq-full) ring_enter with completion ring full
+(ring-cq-full) submissions left queued
+(ring-cq-full) ring_enter after consuming one completion
+(ring-cq-full) one more submitted
+(ring-cq-full) end
+ring-cq-full: exit(0)
+EOF
+pass;
@@ -0,0 +1,31 @@
+/* Submits a chain whose first operation fails.  The rest of the
+   chain must be cancelled, and the operation after the chain
+   must still be carried out. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/userprog/rings.h"
+
+static const char *results[] = {"open", "linked nop", "last nop", "nop"};
+
+void test_main (void)
+{
+  int expected[] = {-1, RING_CANCELED, RING_CANCELED, 0};
+  int i;
+
+  rings_setup (4);
+  ring_submit (RING_OPEN, RING_LINK, -1, "no-such-file", 0, 0);
+  ring_submit (RING_NOP, RING_LINK, -1, NULL, 0, 1);
+  ring_submit (RING_NOP, 0, -1, NULL, 0, 2);
+  ring_submit (RING_NOP, 0, -1, NULL, 0, 3);
+  CHECK (ring_enter (4) == 4, "ring_enter (4)");
+
+  for (i = 0; i < 4; i++)
+    {
+      struct ring_cqe e = ring_reap ();
+      if (e.user_data != (uint32_t) i)
+        fail ("completion %d has user_data %u", i, e.user_data);
+      CHECK (e.result == expected[i], "%s: %d", results[i], e.result);
+    }
+}
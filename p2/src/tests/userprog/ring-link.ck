@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ring-link) begin
+(ring-link) ring_setup (4 entries)
+(ring-link) ring_enter (4)
+(ring-link) open: -1
+(ring-link) linked nop: -2
+(ring-link) last nop: -2
+(ring-link) nop: 0
+(ring-link) end
+ring-link: exit(0)
+EOF
+pass;
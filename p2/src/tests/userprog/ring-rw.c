@@ -0,0 +1,42 @@
+/* Writes a buffer to a file, seeks back, and reads it again,
+   all as one chain of operations submitted by a single
+   ring_enter(). */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/userprog/rings.h"
+
+static char data[] = "Amazing Electronic Fact: If you scuffed your feet "
+                     "long enough without touching anything, you would "
+                     "build up so many electrons that your finger would "
+                     "explode!";
+static char buf[sizeof data];
+
+void test_main (void)
+{
+  struct ring_cqe e;
+  int fd;
+
+  CHECK (create ("ring.txt", sizeof data), "create \"ring.txt\"");
+  CHECK ((fd = open ("ring.txt")) > 1, "open \"ring.txt\"");
+  rings_setup (4);
+
+  ring_submit (RING_WRITE, RING_LINK, fd, data, sizeof data, 1);
+  ring_submit (RING_SEEK, RING_LINK, fd, NULL, 0, 2);
+  ring_submit (RING_READ, 0, fd, buf, sizeof buf, 3);
+  CHECK (ring_enter (3) == 3, "ring_enter (3)");
+
+  e = ring_reap ();
+  if (e.user_data != 1 || e.result != (int) sizeof data)
+    fail ("write completion: user_data %u, result %d", e.user_data, e.result);
+  e = ring_reap ();
+  if (e.user_data != 2 || e.result != 0)
+    fail ("seek completion: user_data %u, result %d", e.user_data, e.result);
+  e = ring_reap ();
+  if (e.user_data != 3 || e.result != (int) sizeof buf)
+    fail ("read completion: user_data %u, result %d", e.user_data, e.result);
+  compare_bytes (buf, data, sizeof data, 0, "ring.txt");
+  msg ("round trip ok");
+}
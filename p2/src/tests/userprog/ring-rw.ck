@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ring-rw) begin
+(ring-rw) create "ring.txt"
+(ring-rw) open "ring.txt"
+(ring-rw) ring_setup (4 entries)
+(ring-rw) ring_enter (3)
+(ring-rw) round trip ok
+(ring-rw) end
+ring-rw: exit(0)
+EOF
+pass;
@@ -0,0 +1,39 @@
+/* Submits more operations than fit in a 4-entry ring, three at
+   a time, so that the indexes wrap around and batches straddle
+   the end of the rings. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/userprog/rings.h"
+
+#define ROUNDS 5
+#define PER_ROUND 3
+
+void test_main (void)
+{
+  uint32_t next = 0;
+  int round;
+  int i;
+
+  rings_setup (4);
+  for (round = 0; round < ROUNDS; round++)
+    {
+      for (i = 0; i < PER_ROUND; i++)
+        ring_submit (RING_NOP, 0, -1, NULL, 0, round * PER_ROUND + i);
+      if (ring_enter (PER_ROUND) != PER_ROUND)
+        fail ("round %d: ring_enter did not carry out %d operations", round,
+              PER_ROUND);
+      for (i = 0; i < PER_ROUND; i++)
+        {
+          struct ring_cqe e = ring_reap ();
+          if (e.user_data != next || e.result != 0)
+            fail ("completion %u: user_data %u, result %d", next,
+                  e.user_data, e.result);
+          next++;
+        }
+    }
+  CHECK (test_sq->head == ROUNDS * PER_ROUND
+         && test_cq->tail == ROUNDS * PER_ROUND,
+         "%d operations completed in order", ROUNDS * PER_ROUND);
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ring-wrap) begin
+(ring-wrap) ring_setup (4 entries)
+(ring-wrap) 15 operations completed in order
+(ring-wrap) end
+ring-wrap: exit(0)
+EOF
+pass;
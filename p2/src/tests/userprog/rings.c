@@ -0,0 +1,66 @@
+/* Utility functions for tests of the submission and completion
+   rings. */
+
+#include "tests/userprog/rings.h"
+#include <syscall.h>
+#include "tests/lib.h"
+
+/* Storage for the largest rings allowed. */
+static struct
+{
+  struct ring_sq ring;
+  struct ring_sqe entries[RING_MAX_ENTRIES];
+} sq_storage;
+static struct
+{
+  struct ring_cq ring;
+  struct ring_cqe entries[RING_MAX_ENTRIES];
+} cq_storage;
+
+struct ring_sq *test_sq = &sq_storage.ring;
+struct ring_cq *test_cq = &cq_storage.ring;
+
+/* Number of entries in the registered rings. */
+static unsigned ring_entries;
+
+/* Registers empty rings of ENTRIES entries each as TEST_SQ and
+   TEST_CQ. */
+void rings_setup (unsigned entries)
+{
+  test_sq->head = test_sq->tail = 0;
+  test_cq->head = test_cq->tail = 0;
+  ring_entries = entries;
+  CHECK (ring_setup (test_sq, test_cq, entries),
+         "ring_setup (%u entries)", entries);
+}
+
+/* Queues an operation in TEST_SQ. */
+void ring_submit (enum ring_op op, uint8_t flags, int fd, void *buf,
+                  uint32_t len, uint32_t user_data)
+{
+  struct ring_sqe *e;
+
+  if (test_sq->tail - test_sq->head >= ring_entries)
+    fail ("submission ring full");
+  e = &test_sq->entries[test_sq->tail % ring_entries];
+  e->op = op;
+  e->flags = flags;
+  e->reserved = 0;
+  e->fd = fd;
+  e->buf = buf;
+  e->len = len;
+  e->user_data = user_data;
+  test_sq->tail++;
+}
+
+/* Removes and returns the next completion from TEST_CQ. */
+struct ring_cqe ring_reap (void)
+{
+  struct ring_cqe e;
+
+  if (test_cq->head == test_cq->tail)
+    fail ("completion ring empty");
+  e = test_cq->entries[test_cq->head % ring_entries];
+  test_cq->head++;
+  return e;
+}
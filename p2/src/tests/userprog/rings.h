@@ -0,0 +1,15 @@
+#ifndef TESTS_USERPROG_RINGS_H
+#define TESTS_USERPROG_RINGS_H
+
+#include <ring.h>
+#include <stdint.h>
+
+extern struct ring_sq *test_sq;
+extern struct ring_cq *test_cq;
+
+void rings_setup (unsigned entries);
+void ring_submit (enum ring_op, uint8_t flags, int fd, void *buf,
+                  uint32_t len, uint32_t user_data);
+struct ring_cqe ring_reap (void);
+
+#endif /* tests/userprog/rings.h */
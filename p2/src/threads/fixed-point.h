@@ -0,0 +1,85 @@
+#ifndef THREADS_FIXED_POINT_H
+#define THREADS_FIXED_POINT_H
+
+#include <stdint.h>
+
+/* Signed 17.14 fixed-point arithmetic, used by the 4.4BSD
+   scheduler for load_avg and recent_cpu.  The kernel does not
+   support floating point, so real numbers are represented as
+   integers scaled by FP_F = 2**14.
+
+   X and Y below are fixed-point numbers; N is an integer.
+   Products and quotients of two fixed-point numbers are formed
+   in 64 bits so that the intermediate value cannot overflow. */
+typedef int fixed_point;
+
+#define FP_SHIFT 14
+#define FP_F (1 << FP_SHIFT)
+
+/* Converts integer N to fixed point. */
+static inline fixed_point fp_from_int (int n)
+{
+  return n * FP_F;
+}
+
+/* Converts X to an integer, rounding toward zero. */
+static inline int fp_to_int (fixed_point x)
+{
+  return x / FP_F;
+}
+
+/* Converts X to an integer, rounding to nearest. */
+static inline int fp_round (fixed_point x)
+{
+  return x >= 0 ? (x + FP_F / 2) / FP_F : (x - FP_F / 2) / FP_F;
+}
+
+/* Returns X + Y. */
+static inline fixed_point fp_add (fixed_point x, fixed_point y)
+{
+  return x + y;
+}
+
+/* Returns X + N. */
+static inline fixed_point fp_add_int (fixed_point x, int n)
+{
+  return x + n * FP_F;
+}
+
+/* Returns X - Y. */
+static inline fixed_point fp_sub (fixed_point x, fixed_point y)
+{
+  return x - y;
+}
+
+/* Returns X - N. */
+static inline fixed_point fp_sub_int (fixed_point x, int n)
+{
+  return x - n * FP_F;
+}
+
+/* Returns X * Y. */
+static inline fixed_point fp_mul (fixed_point x, fixed_point y)
+{
+  return ((int64_t) x) * y / FP_F;
+}
+
+/* Returns X * N. */
+static inline fixed_point fp_mul_int (fixed_point x, int n)
+{
+  return x * n;
+}
+
+/* Returns X / Y. */
+static inline fixed_point fp_div (fixed_point x, fixed_point y)
+{
+  return ((int64_t) x) * FP_F / y;
+}
+
+/* Returns X / N. */
+static inline fixed_point fp_div_int (fixed_point x, int n)
+{
+  return x / n;
+}
+
+#endif /* threads/fixed-point.h */
@@ -0,0 +1,222 @@
+#include "threads/fpu.h"
+#include <debug.h>
+#include <round.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+
+/* Lazy x87/SSE context switching.
+
+   The kernel itself never uses floating point, so only user
+   threads have FPU state worth keeping.  Rather than save and
+   restore the 512-byte FXSAVE area on every context switch, the
+   FPU registers are left holding the state of the last thread
+   that used them, FPU_OWNER, and CR0.TS is set whenever any
+   other thread runs.  The first FPU instruction such a thread
+   executes raises #NM (device not available), whose handler
+   saves FPU_OWNER's state into its save area, loads the running
+   thread's state, and makes it the owner.  Threads that never
+   touch the FPU never take the fault and pay only for keeping
+   TS set, which costs nothing while it is already set.
+
+   Each thread's save area is allocated the first time the
+   thread uses the FPU and freed when it exits. */
+
+/* CR0 bits. */
+#define CR0_MP 0x00000002 /* Monitor coprocessor: WAIT obeys TS. */
+#define CR0_EM 0x00000004 /* Emulation: all FPU instructions trap. */
+#define CR0_TS 0x00000008 /* Task switched: next FPU use traps. */
+#define CR0_NE 0x00000020 /* FPU errors raise #MF. */
+
+/* CR4 bits. */
+#define CR4_OSFXSR 0x00000200     /* Enable FXSAVE and SSE. */
+#define CR4_OSXMMEXCPT 0x00000400 /* SSE errors raise #XF. */
+
+/* CPUID leaf 1 EDX bits. */
+#define CPUID_FXSR (1u << 24) /* FXSAVE and FXRSTOR. */
+#define CPUID_SSE (1u << 25)  /* SSE. */
+
+/* Size and alignment of a save area.  FSAVE needs only 108
+   bytes, so this suffices for both formats. */
+#define FPU_SAVE_SIZE 512
+#define FPU_SAVE_ALIGN 16
+
+/* Default MXCSR: all SSE exceptions masked. */
+#define MXCSR_DEFAULT 0x1f80
+
+/* Thread whose state is in the FPU registers, or NULL. */
+static struct thread *fpu_owner;
+
+/* Is CR0.TS set?  Mirrors the register, to avoid reading or
+   writing CR0 in the common case of no change. */
+static bool fpu_ts;
+
+/* CPU support for FXSAVE and for SSE. */
+static bool has_fxsr;
+static bool has_sse;
+
+static intr_handler_func fpu_trap;
+
+static inline uint32_t read_cr0 (void)
+{
+  uint32_t cr0;
+  asm volatile ("movl %%cr0, %0" : "=r"(cr0));
+  return cr0;
+}
+
+static inline void write_cr0 (uint32_t cr0)
+{
+  asm volatile ("movl %0, %%cr0" : : "r"(cr0) : "memory");
+}
+
+/* Sets CR0.TS, so that the next FPU instruction traps. */
+static inline void set_ts (void)
+{
+  if (!fpu_ts)
+    {
+      write_cr0 (read_cr0 () | CR0_TS);
+      fpu_ts = true;
+    }
+}
+
+/* Clears CR0.TS, so that FPU instructions run. */
+static inline void clear_ts (void)
+{
+  if (fpu_ts)
+    {
+      asm volatile ("clts" : : : "memory");
+      fpu_ts = false;
+    }
+}
+
+/* Returns T's save area, aligned as FXSAVE requires. */
+static inline void *save_area (struct thread *t)
+{
+  return (void *) ROUND_UP ((uintptr_t) t->fpu_area, FPU_SAVE_ALIGN);
+}
+
+/* Enables the FPU, and SSE if the CPU has it, for lazy switching,
+   and installs the #NM handler.  The boot code sets CR0.EM, which
+   makes every FPU instruction trap; it is cleared here. */
+void fpu_init (void)
+{
+  uint32_t eax, ebx, ecx, edx;
+  uint32_t cr0;
+
+  asm volatile ("cpuid"
+                : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx)
+                : "a"(1));
+  has_fxsr = (edx & CPUID_FXSR) != 0;
+  has_sse = has_fxsr && (edx & CPUID_SSE) != 0;
+  if (has_fxsr)
+    {
+      uint32_t cr4;
+      asm volatile ("movl %%cr4, %0" : "=r"(cr4));
+      cr4 |= CR4_OSFXSR;
+      if (has_sse)
+        cr4 |= CR4_OSXMMEXCPT;
+      asm volatile ("movl %0, %%cr4" : : "r"(cr4));
+    }
+
+  cr0 = read_cr0 ();
+  cr0 &= ~CR0_EM;
+  cr0 |= CR0_MP | CR0_NE | CR0_TS;
+  write_cr0 (cr0);
+  fpu_ts = true;
+
+  intr_register_int (7, 0, INTR_ON, fpu_trap,
+                     "#NM Device Not Available Exception");
+}
+
+/* Called while switching to thread T, with interrupts off.
+   Lets T use the FPU directly if its state is already loaded and
+   makes it trap otherwise. */
+void fpu_activate (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (t == fpu_owner)
+    clear_ts ();
+  else
+    set_ts ();
+}
+
+/* Releases the running thread's FPU state.  Called as the thread
+   exits. */
+void fpu_exit (void)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (fpu_owner == cur)
+    {
+      fpu_owner = NULL;
+      set_ts ();
+    }
+  intr_set_level (old_level);
+
+  free (cur->fpu_area);
+  cur->fpu_area = NULL;
+}
+
+/* #NM handler.  Hands the FPU to the running thread, saving the
+   state of the thread that last used it and loading the running
+   thread's own state, or a freshly initialized state if this is
+   its first use. */
+static void fpu_trap (struct intr_frame *f)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  bool fresh = false;
+
+  if ((f->cs & 3) == 0)
+    {
+      intr_dump_frame (f);
+      PANIC ("Kernel bug - floating point used in kernel");
+    }
+
+  if (cur->fpu_area == NULL)
+    {
+      cur->fpu_area = malloc (FPU_SAVE_SIZE + FPU_SAVE_ALIGN - 1);
+      if (cur->fpu_area == NULL)
+        {
+          printf ("%s: out of memory for floating-point state\n",
+                  thread_name ());
+          thread_exit ();
+        }
+      fresh = true;
+    }
+
+  old_level = intr_disable ();
+  clear_ts ();
+  if (fpu_owner != cur)
+    {
+      if (fpu_owner != NULL)
+        {
+          if (has_fxsr)
+            asm volatile ("fxsave (%0)" : : "r"(save_area (fpu_owner))
+                          : "memory");
+          else
+            asm volatile ("fnsave (%0)" : : "r"(save_area (fpu_owner))
+                          : "memory");
+        }
+
+      if (fresh)
+        {
+          uint32_t mxcsr = MXCSR_DEFAULT;
+          asm volatile ("fninit");
+          if (has_sse)
+            asm volatile ("ldmxcsr %0" : : "m"(mxcsr));
+        }
+      else if (has_fxsr)
+        asm volatile ("fxrstor (%0)" : : "r"(save_area (cur)) : "memory");
+      else
+        asm volatile ("frstor (%0)" : : "r"(save_area (cur)) : "memory");
+      fpu_owner = cur;
+    }
+  intr_set_level (old_level);
+}
@@ -0,0 +1,10 @@
+#ifndef THREADS_FPU_H
+#define THREADS_FPU_H
+
+struct thread;
+
+void fpu_init (void);
+void fpu_activate (struct thread *);
+void fpu_exit (void);
+
+#endif /* threads/fpu.h */
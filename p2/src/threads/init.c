@@ -15,16 +15,21 @@
 #include "devices/timer.h"
 #include "devices/vga.h"
 #include "devices/rtc.h"
+#include "threads/fpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/profile.h"
+#include "threads/trace.h"
+#include "threads/workqueue.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
+#include "userprog/execcache.h"
 #include "userprog/gdt.h"
 #include "userprog/syscall.h"
 #include "userprog/tss.h"
@@ -57,6 +62,21 @@ static const char *swap_bdev_name;
 /* -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
+/* -bootstats: Print how long each phase of booting took? */
+static bool boot_stats;
+
+/* Phases of booting, each with the TSC at its end.  The TSC
+   counts from processor reset, so the TSC at kernel entry
+   measures the BIOS and the loader. */
+#define BOOT_PHASE_CNT 16
+static struct boot_phase
+{
+  const char *name;
+  uint64_t tsc;
+} boot_phases[BOOT_PHASE_CNT];
+static size_t boot_phase_cnt;
+static uint64_t boot_start_tsc;
+
 static void bss_init (void);
 static void paging_init (void);
 
@@ -64,6 +84,8 @@ static char **read_command_line (void);
 static char **parse_options (char **argv);
 static void run_actions (char **argv);
 static void usage (void);
+static void boot_phase_end (const char *name);
+static void print_boot_stats (void);
 
 #ifdef FILESYS
 static void locate_block_devices (void);
@@ -77,6 +99,7 @@ int main (void)
 
   /* Clear BSS. */
   bss_init ();
+  boot_start_tsc = timer_rdtsc ();
 
   /* Break command line into arguments and parse options. */
   argv = read_command_line ();
@@ -86,6 +109,7 @@ int main (void)
      then enable console locking. */
   thread_init ();
   console_init ();
+  boot_phase_end ("threads and console");
 
   /* Greet user. */
   printf ("Pintos booting with %'" PRIu32 " kB RAM...\n",
@@ -95,36 +119,51 @@ int main (void)
   palloc_init (user_page_limit);
   malloc_init ();
   paging_init ();
+  boot_phase_end ("memory");
+  profile_init ();
+  trace_init ();
+  boot_phase_end ("profiling and tracing");
 
   /* Segmentation. */
 #ifdef USERPROG
   tss_init ();
   gdt_init ();
+  boot_phase_end ("segmentation");
 #endif
 
   /* Initialize interrupt handlers. */
   intr_init ();
+  fpu_init ();
   timer_init ();
   kbd_init ();
   input_init ();
 #ifdef USERPROG
   exception_init ();
   syscall_init ();
+  exec_cache_init ();
 #endif
+  boot_phase_end ("interrupts");
 
   /* Start thread scheduler and enable interrupts. */
+  workqueue_init ();
   thread_start ();
   serial_init_queue ();
+  boot_phase_end ("scheduler");
   timer_calibrate ();
+  boot_phase_end ("timer calibration");
 
 #ifdef FILESYS
   /* Initialize file system. */
   ide_init ();
   locate_block_devices ();
+  boot_phase_end ("block devices");
   filesys_init (format_filesys);
+  boot_phase_end ("file system");
 #endif
 
   printf ("Boot complete.\n");
+  if (boot_stats)
+    print_boot_stats ();
 
   /* Run actions specified on kernel command line. */
   run_actions (argv);
@@ -134,6 +173,38 @@ int main (void)
   thread_exit ();
 }
 
+/* Records the end of the boot phase called NAME. */
+static void boot_phase_end (const char *name)
+{
+  if (boot_phase_cnt < BOOT_PHASE_CNT)
+    {
+      boot_phases[boot_phase_cnt].name = name;
+      boot_phases[boot_phase_cnt].tsc = timer_rdtsc ();
+      boot_phase_cnt++;
+    }
+}
+
+/* Prints how long each phase of booting took.  Must be called
+   after timer_calibrate(), which the conversion of TSC cycles to
+   time depends on. */
+static void print_boot_stats (void)
+{
+  uint64_t prev = boot_start_tsc;
+  size_t i;
+
+  printf ("Boot: %'" PRIu64 " us in BIOS and loader.\n",
+          timer_tsc_to_ns (boot_start_tsc) / 1000);
+  for (i = 0; i < boot_phase_cnt; i++)
+    {
+      printf ("Boot: %'" PRIu64 " us in %s.\n",
+              timer_tsc_to_ns (boot_phases[i].tsc - prev) / 1000,
+              boot_phases[i].name);
+      prev = boot_phases[i].tsc;
+    }
+  printf ("Boot: %'" PRIu64 " us from kernel entry to first action.\n",
+          timer_tsc_to_ns (timer_rdtsc () - boot_start_tsc) / 1000);
+}
+
 /* Clear the "BSS", a segment that should be initialized to
    zeros.  It isn't actually stored on disk or zeroed by the
    kernel loader, so we have to zero it ourselves.
@@ -249,9 +320,23 @@ static char **parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-tickless"))
+        timer_tickless = true;
+      else if (!strcmp (name, "-calib"))
+        timer_calib_loops = atoi (value);
+      else if (!strcmp (name, "-bootstats"))
+        boot_stats = true;
+      else if (!strcmp (name, "-profile"))
+        profile_sample_cnt =
+            value != NULL ? (size_t) atoi (value) : PROFILE_DEFAULT_CNT;
+      else if (!strcmp (name, "-trace"))
+        trace_event_cnt =
+            value != NULL ? (size_t) atoi (value) : TRACE_DEFAULT_CNT;
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
+      else if (!strcmp (name, "-procstat"))
+        procstat_on_exit = true;
 #endif
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
@@ -327,7 +412,15 @@ static void run_actions (char **argv)
           PANIC ("action `%s' requires %d argument(s)", *argv, a->argc - 1);
 
       /* Invoke action and advance. */
-      a->function (argv);
+      if (boot_stats)
+        {
+          uint64_t start = timer_ns ();
+          a->function (argv);
+          printf ("Boot: action `%s' took %'" PRIu64 " us.\n", a->name,
+                  (timer_ns () - start) / 1000);
+        }
+      else
+        a->function (argv);
       argv += a->argc;
     }
 }
@@ -367,8 +460,14 @@ static void usage (void)
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -tickless          Stop the periodic timer tick while idle.\n"
+          "  -calib=LOOPS       Assume LOOPS loops/s instead of calibrating.\n"
+          "  -bootstats         Print how long each phase of booting took.\n"
+          "  -profile[=COUNT]   Sample timer interrupts, keeping COUNT.\n"
+          "  -trace[=COUNT]     Trace kernel events, keeping COUNT.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+          "  -procstat          Print CPU statistics as processes exit.\n"
 #endif
   );
   shutdown_power_off ();
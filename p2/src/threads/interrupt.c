@@ -7,6 +7,7 @@
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
 #include "devices/timer.h"
 
@@ -340,6 +341,7 @@ void intr_handler (struct intr_frame *frame)
       in_external_intr = true;
       yield_on_return = false;
     }
+  TRACE (TRACE_INTR_ENTER, frame->vec_no, frame->eip);
 
   /* Invoke the interrupt's handler. */
   handler = intr_handlers[frame->vec_no];
@@ -353,6 +355,7 @@ void intr_handler (struct intr_frame *frame)
     }
   else
     unexpected_interrupt (frame);
+  TRACE (TRACE_INTR_EXIT, frame->vec_no, 0);
 
   /* Complete the processing of an external interrupt. */
   if (external)
@@ -364,7 +367,7 @@ void intr_handler (struct intr_frame *frame)
       pic_end_of_interrupt (frame->vec_no);
 
       if (yield_on_return)
-        thread_yield ();
+        thread_yield_preempted ();
     }
 }
 
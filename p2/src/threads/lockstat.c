@@ -0,0 +1,150 @@
+#include "threads/lockstat.h"
+#ifdef LOCKSTAT
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+
+/* Maximum number of distinct lock names tracked.  Locks beyond
+   this many names share the final, "other" slot. */
+#define LOCKSTAT_CNT 64
+
+/* Statistics for each lock name, in order of registration. */
+static struct lockstat stats[LOCKSTAT_CNT];
+static size_t stat_cnt;
+
+static int wait_cycles_more (const void *, const void *);
+static const char *short_name (const char *);
+
+/* Returns the statistics slot for locks named NAME, creating it
+   if this is the first lock with that name.  NAME must remain
+   valid for as long as the kernel runs. */
+struct lockstat *lockstat_register (const char *name)
+{
+  struct lockstat *s;
+  enum intr_level old_level;
+  size_t i;
+
+  if (name == NULL)
+    name = "(unnamed)";
+
+  old_level = intr_disable ();
+  for (i = 0; i < stat_cnt; i++)
+    if (stats[i].name == name || !strcmp (stats[i].name, name))
+      break;
+  if (i == stat_cnt)
+    {
+      if (stat_cnt < LOCKSTAT_CNT - 1)
+        stats[stat_cnt++].name = name;
+      else
+        {
+          i = LOCKSTAT_CNT - 1;
+          stats[i].name = "(other)";
+          stat_cnt = LOCKSTAT_CNT;
+        }
+    }
+  s = &stats[i];
+  intr_set_level (old_level);
+
+  return s;
+}
+
+/* Records an acquisition of a lock whose statistics are S, after
+   waiting WAIT_CYCLES.  CONTENDED is true if the lock was held by
+   another thread when the acquirer arrived.  Failed
+   lock_try_acquire() calls are not recorded. */
+void lockstat_acquired (struct lockstat *s, bool contended,
+                        uint64_t wait_cycles)
+{
+  enum intr_level old_level = intr_disable ();
+  s->acquires++;
+  if (contended)
+    {
+      s->contended++;
+      s->wait_cycles += wait_cycles;
+      if (wait_cycles > s->max_wait_cycles)
+        s->max_wait_cycles = wait_cycles;
+    }
+  intr_set_level (old_level);
+}
+
+/* Records the release of a lock whose statistics are S, after
+   holding it for HOLD_CYCLES. */
+void lockstat_released (struct lockstat *s, uint64_t hold_cycles)
+{
+  enum intr_level old_level = intr_disable ();
+  s->hold_cycles += hold_cycles;
+  intr_set_level (old_level);
+}
+
+/* Zeroes all the counters, keeping the names. */
+void lockstat_reset (void)
+{
+  enum intr_level old_level = intr_disable ();
+  size_t i;
+
+  for (i = 0; i < stat_cnt; i++)
+    {
+      const char *name = stats[i].name;
+      memset (&stats[i], 0, sizeof stats[i]);
+      stats[i].name = name;
+    }
+  intr_set_level (old_level);
+}
+
+/* Prints the TOP_CNT lock names with the most total wait time.
+   Holds that were never contended are omitted. */
+void lockstat_print_stats (size_t top_cnt)
+{
+  static struct lockstat snapshot[LOCKSTAT_CNT];
+  enum intr_level old_level;
+  size_t cnt, i;
+
+  old_level = intr_disable ();
+  cnt = stat_cnt;
+  memcpy (snapshot, stats, cnt * sizeof *snapshot);
+  intr_set_level (old_level);
+
+  qsort (snapshot, cnt, sizeof *snapshot, wait_cycles_more);
+  if (top_cnt > cnt)
+    top_cnt = cnt;
+
+  printf ("Locks: %zu names tracked; most waited on (times in us):\n", cnt);
+  printf ("  %10s %10s %10s %8s %10s  %s\n",
+          "acquires", "contended", "wait", "max", "hold", "name");
+  for (i = 0; i < top_cnt && snapshot[i].contended > 0; i++)
+    {
+      const struct lockstat *s = &snapshot[i];
+      printf ("  %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %8" PRIu64
+              " %10" PRIu64 "  %s\n",
+              s->acquires, s->contended,
+              timer_tsc_to_ns (s->wait_cycles) / 1000,
+              timer_tsc_to_ns (s->max_wait_cycles) / 1000,
+              timer_tsc_to_ns (s->hold_cycles) / 1000, short_name (s->name));
+    }
+}
+
+/* qsort() comparison function that puts statistics with more
+   total wait time first. */
+static int wait_cycles_more (const void *a_, const void *b_)
+{
+  const struct lockstat *a = a_;
+  const struct lockstat *b = b_;
+
+  return a->wait_cycles < b->wait_cycles ? 1
+         : a->wait_cycles > b->wait_cycles ? -1
+                                           : 0;
+}
+
+/* Strips the "../../" that the build prefixes to source file
+   names from NAME. */
+static const char *short_name (const char *name)
+{
+  while (!memcmp (name, "../", 3))
+    name += 3;
+  return name;
+}
+#endif /* LOCKSTAT */
@@ -0,0 +1,35 @@
+#ifndef THREADS_LOCKSTAT_H
+#define THREADS_LOCKSTAT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Lock contention statistics.
+
+   Built only if LOCKSTAT is defined, e.g. by "make LOCKSTAT=1".
+   Locks are grouped by name: every lock initialized with the same
+   name, or at the same lock_init() call site, shares one set of
+   counters.  Times are measured with the time-stamp counter.
+   The most waited-on names are printed at shutdown; the lockstat
+   system call prints or resets them at any time. */
+struct lockstat
+{
+  const char *name;         /* Lock name or initialization site. */
+  uint64_t acquires;        /* # of successful acquisitions. */
+  uint64_t contended;       /* # of acquisitions that found it held. */
+  uint64_t wait_cycles;     /* Total TSC cycles spent waiting. */
+  uint64_t max_wait_cycles; /* Longest single wait. */
+  uint64_t hold_cycles;     /* Total TSC cycles held. */
+};
+
+#ifdef LOCKSTAT
+struct lockstat *lockstat_register (const char *name);
+void lockstat_acquired (struct lockstat *, bool contended,
+                        uint64_t wait_cycles);
+void lockstat_released (struct lockstat *, uint64_t hold_cycles);
+void lockstat_reset (void);
+void lockstat_print_stats (size_t top_cnt);
+#endif
+
+#endif /* threads/lockstat.h */
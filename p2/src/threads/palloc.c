@@ -36,6 +36,9 @@ struct pool
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
+/* Frees cached kernel pages when the kernel pool runs out. */
+static palloc_reclaim_func *reclaim;
+
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
@@ -79,6 +82,16 @@ void *palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
   page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
   lock_release (&pool->lock);
 
+  /* Out of kernel pages: have the caches give some back, then
+     try once more. */
+  if (page_idx == BITMAP_ERROR && pool == &kernel_pool && reclaim != NULL
+      && reclaim (page_cnt) > 0)
+    {
+      lock_acquire (&pool->lock);
+      page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+      lock_release (&pool->lock);
+    }
+
   if (page_idx != BITMAP_ERROR)
     pages = pool->base + PGSIZE * page_idx;
   else
@@ -140,6 +153,10 @@ void palloc_free_multiple (void *pages, size_t page_cnt)
 /* Frees the page at PAGE. */
 void palloc_free_page (void *page) { palloc_free_multiple (page, 1); }
 
+/* Sets FUNC as the function that palloc_get_multiple() calls to
+   reclaim cached pages when the kernel pool is exhausted. */
+void palloc_set_reclaim (palloc_reclaim_func *func) { reclaim = func; }
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void init_pool (struct pool *p, void *base, size_t page_cnt,
@@ -157,7 +174,7 @@ static void init_pool (struct pool *p, void *base, size_t page_cnt,
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
-  lock_init (&p->lock);
+  lock_init_named (&p->lock, name);
   p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
   p->base = ((uint8_t *) base) + bm_pages * PGSIZE;
 }
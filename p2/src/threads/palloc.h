@@ -17,4 +17,10 @@ void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
 
+/* Called when the kernel pool cannot satisfy a request for
+   PAGE_CNT pages, to free pages that a cache holds.  Returns the
+   number of pages freed. */
+typedef size_t palloc_reclaim_func (size_t page_cnt);
+void palloc_set_reclaim (palloc_reclaim_func *);
+
 #endif /* threads/palloc.h */
@@ -0,0 +1,180 @@
+#include "threads/profile.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef USERPROG
+#include "userprog/pagedir.h"
+#endif
+
+/* Sampling profiler.
+
+   When enabled, every timer interrupt records the instruction
+   it interrupted, the return address found in the interrupted
+   function's stack frame, and the running thread, in a ring
+   buffer allocated at boot.  At shutdown, profile_dump() writes
+   the samples to the console, from which the host-side
+   "profile" utility symbolizes them against kernel.o and the
+   user programs into a flat profile and a call-site profile. */
+
+/* One sample. */
+struct profile_sample
+{
+  uint32_t eip;    /* Interrupted instruction. */
+  uint32_t caller; /* Return address of its stack frame, or 0. */
+  tid_t tid;       /* Running thread. */
+  bool user;       /* Interrupted in user mode? */
+};
+
+/* Number of samples the ring buffer holds.  Nonzero enables the
+   profiler.  Set by kernel command-line option "-profile". */
+size_t profile_sample_cnt;
+
+/* Ring buffer of samples.  SAMPLE_HEAD is the index of the slot
+   for the next sample, and SAMPLE_TOTAL the number of samples
+   ever taken. */
+static struct profile_sample *samples;
+static size_t sample_head;
+static uint64_t sample_total;
+
+/* Names of the threads seen in samples, so that the host tool
+   can find the user program each one ran.  Recorded when a
+   thread is first sampled. */
+#define PROFILE_THREAD_CNT 128
+struct profile_thread
+{
+  tid_t tid;
+  char name[16];
+};
+static struct profile_thread threads[PROFILE_THREAD_CNT];
+static size_t thread_cnt;
+static tid_t last_tid = TID_ERROR;
+
+static uint32_t frame_caller (const struct intr_frame *);
+static void note_thread (const struct thread *);
+
+/* Allocates the sample buffer, if the profiler is enabled.  Must
+   be called after palloc_init() and before timer interrupts can
+   call profile_sample(). */
+void profile_init (void)
+{
+  size_t page_cnt;
+
+  if (!profile_enabled ())
+    return;
+
+  page_cnt = DIV_ROUND_UP (profile_sample_cnt * sizeof *samples, PGSIZE);
+  samples = palloc_get_multiple (PAL_ZERO, page_cnt);
+  if (samples == NULL)
+    PANIC ("profile: could not allocate %zu pages for %zu samples",
+           page_cnt, profile_sample_cnt);
+}
+
+/* Records a sample of the code that timer interrupt frame F
+   interrupted.  Called from the timer interrupt handler. */
+void profile_sample (const struct intr_frame *f)
+{
+  struct thread *t = thread_current ();
+  struct profile_sample *s;
+
+  ASSERT (intr_context ());
+
+  s = &samples[sample_head];
+  if (++sample_head == profile_sample_cnt)
+    sample_head = 0;
+  sample_total++;
+  s->eip = (uint32_t) f->eip;
+  s->caller = frame_caller (f);
+  s->tid = t->tid;
+  s->user = (f->cs & 3) == 3;
+
+  if (t->tid != last_tid)
+    {
+      note_thread (t);
+      last_tid = t->tid;
+    }
+}
+
+/* Writes the thread names and samples to the console, in the
+   format that utils/profile reads. */
+void profile_dump (void)
+{
+  size_t cnt, i;
+
+  if (!profile_enabled ())
+    return;
+
+  intr_disable ();
+  cnt = sample_total < profile_sample_cnt ? sample_total : profile_sample_cnt;
+  printf ("Profile: %zu samples at %d Hz, %" PRIu64 " overwritten.\n",
+          cnt, TIMER_FREQ, sample_total - cnt);
+  for (i = 0; i < thread_cnt; i++)
+    printf ("profile-thread %d %s\n", threads[i].tid, threads[i].name);
+  for (i = 0; i < cnt; i++)
+    {
+      size_t idx = (sample_head + profile_sample_cnt - cnt + i)
+                   % profile_sample_cnt;
+      const struct profile_sample *s = &samples[idx];
+      printf ("profile-sample %d %c %#" PRIx32 " %#" PRIx32 "\n",
+              s->tid, s->user ? 'u' : 'k', s->eip, s->caller);
+    }
+  printf ("Profile end.\n");
+}
+
+/* Returns the return address saved in the stack frame that F's
+   frame pointer designates, or 0 if that cannot be read safely
+   from an interrupt handler. */
+static uint32_t frame_caller (const struct intr_frame *f)
+{
+  const uint32_t *ebp = (const uint32_t *) f->ebp;
+
+  if ((uintptr_t) ebp % sizeof *ebp != 0)
+    return 0;
+
+  if ((f->cs & 3) == 0)
+    {
+      /* Kernel frames live in the running thread's page. */
+      if (pg_round_down (ebp) != pg_round_down (thread_current ()) ||
+          pg_ofs (ebp + 1) == 0)
+        return 0;
+      return ebp[1];
+    }
+
+#ifdef USERPROG
+  /* Read user frames through the kernel mapping, so that a bad
+     frame pointer cannot fault. */
+  if (is_user_vaddr (ebp + 2))
+    {
+      uint32_t *kpage =
+          pagedir_get_page (thread_current ()->pagedir, ebp + 1);
+      if (kpage != NULL)
+        return *kpage;
+    }
+#endif
+  return 0;
+}
+
+/* Adds T to the table of thread names, if it is not there
+   already and there is room. */
+static void note_thread (const struct thread *t)
+{
+  size_t i;
+
+  for (i = 0; i < thread_cnt; i++)
+    if (threads[i].tid == t->tid)
+      return;
+  if (thread_cnt < PROFILE_THREAD_CNT)
+    {
+      threads[thread_cnt].tid = t->tid;
+      strlcpy (threads[thread_cnt].name, t->name,
+               sizeof threads[thread_cnt].name);
+      thread_cnt++;
+    }
+}
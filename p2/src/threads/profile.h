@@ -0,0 +1,26 @@
+#ifndef THREADS_PROFILE_H
+#define THREADS_PROFILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct intr_frame;
+
+/* Sampling profiler.  Enabled by kernel command-line option
+   "-profile[=SAMPLES]". */
+extern size_t profile_sample_cnt;
+
+/* Number of samples kept if "-profile" gives no count. */
+#define PROFILE_DEFAULT_CNT 8192
+
+void profile_init (void);
+void profile_sample (const struct intr_frame *);
+void profile_dump (void);
+
+/* Returns true if the profiler is collecting samples. */
+static inline bool profile_enabled (void)
+{
+  return profile_sample_cnt != 0;
+}
+
+#endif /* threads/profile.h */
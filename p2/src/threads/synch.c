@@ -29,8 +29,13 @@
 #include "threads/synch.h"
 #include <stdio.h>
 #include <string.h>
+#include "devices/timer.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+
+static list_less_func thread_priority_less;
+static list_less_func sema_elem_priority_less;
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -99,7 +104,9 @@ bool sema_try_down (struct semaphore *sema)
 }
 
 /* Up or "V" operation on a semaphore.  Increments SEMA's value
-   and wakes up one thread of those waiting for SEMA, if any.
+   and wakes up the highest-priority thread of those waiting for
+   SEMA, if any.  If that thread outranks the running thread, the
+   running thread yields to it.
 
    This function may be called from an interrupt handler. */
 void sema_up (struct semaphore *sema)
@@ -110,10 +117,16 @@ void sema_up (struct semaphore *sema)
 
   old_level = intr_disable ();
   if (!list_empty (&sema->waiters))
-    thread_unblock (
-        list_entry (list_pop_front (&sema->waiters), struct thread, elem));
+    {
+      struct list_elem *e =
+          list_max (&sema->waiters, thread_priority_less, NULL);
+      list_remove (e);
+      thread_unblock (list_entry (e, struct thread, elem));
+    }
   sema->value++;
   intr_set_level (old_level);
+
+  thread_preempt ();
 }
 
 static void sema_test_helper (void *sema_);
@@ -165,31 +178,68 @@ static void sema_test_helper (void *sema_)
    another one "up" it, but with a lock the same thread must both
    acquire and release it.  When these restrictions prove
    onerous, it's a good sign that a semaphore should be used,
-   instead of a lock. */
-void lock_init (struct lock *lock)
+   instead of a lock.
+
+   (The parentheses keep the lock_init() macro that synch.h
+   defines when LOCKSTAT is enabled from expanding here.) */
+void(lock_init) (struct lock *lock) { lock_init_named (lock, NULL); }
+
+/* Initializes LOCK, as lock_init() does, and names it NAME in
+   lock statistics.  NAME must remain valid for as long as the
+   kernel runs.  If NAME is null, the lock is reported as
+   unnamed. */
+void lock_init_named (struct lock *lock, const char *name UNUSED)
 {
   ASSERT (lock != NULL);
 
   lock->holder = NULL;
   sema_init (&lock->semaphore, 1);
+#ifdef LOCKSTAT
+  lock->stat = lockstat_register (name);
+#endif
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
    necessary.  The lock must not already be held by the current
    thread.
 
+   If the lock is held by a lower-priority thread, the current
+   thread donates its priority to the holder, and onward through
+   any lock the holder is itself waiting for, until it can run.
+
    This function may sleep, so it must not be called within an
    interrupt handler.  This function may be called with
    interrupts disabled, but interrupts will be turned back on if
    we need to sleep. */
 void lock_acquire (struct lock *lock)
 {
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
+#ifdef LOCKSTAT
+  uint64_t start = timer_rdtsc ();
+  bool contended = lock->holder != NULL;
+#endif
+  if (lock->holder != NULL)
+    {
+      TRACE (TRACE_LOCK_BLOCK, lock, lock->holder->tid);
+      cur->waiting_lock = lock;
+      thread_donate_priority (cur);
+    }
   sema_down (&lock->semaphore);
-  lock->holder = thread_current ();
+  cur->waiting_lock = NULL;
+  lock->holder = cur;
+  list_push_back (&cur->held_locks, &lock->elem);
+#ifdef LOCKSTAT
+  lock->acquired_at = timer_rdtsc ();
+  lockstat_acquired (lock->stat, contended, lock->acquired_at - start);
+#endif
+  intr_set_level (old_level);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -207,21 +257,46 @@ bool lock_try_acquire (struct lock *lock)
 
   success = sema_try_down (&lock->semaphore);
   if (success)
-    lock->holder = thread_current ();
+    {
+      enum intr_level old_level = intr_disable ();
+      lock->holder = thread_current ();
+      list_push_back (&lock->holder->held_locks, &lock->elem);
+#ifdef LOCKSTAT
+      lock->acquired_at = timer_rdtsc ();
+      lockstat_acquired (lock->stat, false, 0);
+#endif
+      intr_set_level (old_level);
+    }
   return success;
 }
 
 /* Releases LOCK, which must be owned by the current thread.
+   Any priority donated through LOCK is given up, which may cause
+   the current thread to yield to the waiter that acquires it.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to release a lock within an interrupt
    handler. */
 void lock_release (struct lock *lock)
 {
+  enum intr_level old_level;
+
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
+#ifdef LOCKSTAT
+  lockstat_released (lock->stat, timer_rdtsc () - lock->acquired_at);
+#endif
   lock->holder = NULL;
+  list_remove (&lock->elem);
+  thread_recompute_priority (thread_current ());
+  if (__builtin_expect (trace_enabled, 0)
+      && !list_empty (&lock->semaphore.waiters))
+    trace_record (TRACE_LOCK_WAKE, (uint32_t) lock,
+                  list_size (&lock->semaphore.waiters));
+  intr_set_level (old_level);
+
   sema_up (&lock->semaphore);
 }
 
@@ -240,6 +315,7 @@ struct semaphore_elem
 {
   struct list_elem elem;      /* List element. */
   struct semaphore semaphore; /* This semaphore. */
+  struct thread *thread;      /* Thread waiting on SEMAPHORE. */
 };
 
 /* Initializes condition variable COND.  A condition variable
@@ -282,6 +358,7 @@ void cond_wait (struct condition *cond, struct lock *lock)
   ASSERT (lock_held_by_current_thread (lock));
 
   sema_init (&waiter.semaphore, 0);
+  waiter.thread = thread_current ();
   list_push_back (&cond->waiters, &waiter.elem);
   lock_release (lock);
   sema_down (&waiter.semaphore);
@@ -289,7 +366,8 @@ void cond_wait (struct condition *cond, struct lock *lock)
 }
 
 /* If any threads are waiting on COND (protected by LOCK), then
-   this function signals one of them to wake up from its wait.
+   this function signals the highest-priority one to wake up from
+   its wait.
    LOCK must be held before calling this function.
 
    An interrupt handler cannot acquire a lock, so it does not
@@ -303,9 +381,12 @@ void cond_signal (struct condition *cond, struct lock *lock UNUSED)
   ASSERT (lock_held_by_current_thread (lock));
 
   if (!list_empty (&cond->waiters))
-    sema_up (&list_entry (list_pop_front (&cond->waiters),
-                          struct semaphore_elem, elem)
-                  ->semaphore);
+    {
+      struct list_elem *e =
+          list_max (&cond->waiters, sema_elem_priority_less, NULL);
+      list_remove (e);
+      sema_up (&list_entry (e, struct semaphore_elem, elem)->semaphore);
+    }
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -322,3 +403,468 @@ void cond_broadcast (struct condition *cond, struct lock *lock)
   while (!list_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
+
+/* Orders threads on a semaphore's wait list by priority, so that
+   list_max() finds the waiter to wake first.  Of equal-priority
+   waiters, list_max() returns the earliest, preserving FIFO
+   order among them. */
+static bool thread_priority_less (const struct list_elem *a_,
+                                  const struct list_elem *b_,
+                                  void *aux UNUSED)
+{
+  const struct thread *a = list_entry (a_, struct thread, elem);
+  const struct thread *b = list_entry (b_, struct thread, elem);
+
+  return a->priority < b->priority;
+}
+
+/* Orders the semaphore_elems on a condition variable's wait list
+   by the priority of the thread waiting on each.  The waiter may
+   not have reached sema_down() yet, so we cannot look at the
+   semaphore's own wait list. */
+static bool sema_elem_priority_less (const struct list_elem *a_,
+                                     const struct list_elem *b_,
+                                     void *aux UNUSED)
+{
+  const struct semaphore_elem *a =
+      list_entry (a_, struct semaphore_elem, elem);
+  const struct semaphore_elem *b =
+      list_entry (b_, struct semaphore_elem, elem);
+
+  return a->thread->priority < b->thread->priority;
+}
+
+/* Initializes RWLOCK.  A reader-writer lock may be held for
+   reading by any number of threads at once, or for writing by a
+   single thread.
+
+   Writers are preferred: once a writer is waiting, newly
+   arriving readers wait behind it, so a steady stream of readers
+   cannot starve writers.  To keep writers from starving readers
+   in turn, the readers that were already waiting when a writer
+   releases the lock are all admitted before the next writer. */
+void(rwlock_init) (struct rwlock *rw) { rwlock_init_named (rw, NULL); }
+
+/* Initializes RW, as rwlock_init() does, and names it NAME in
+   lock statistics, which count time spent waiting for and
+   holding write access and waiting for read access. */
+void rwlock_init_named (struct rwlock *rw, const char *name UNUSED)
+{
+  ASSERT (rw != NULL);
+
+  lock_init_named (&rw->lock, "struct rwlock (internal)");
+  cond_init (&rw->readers_ok);
+  cond_init (&rw->writers_ok);
+  rw->readers = 0;
+  rw->waiting_writers = 0;
+  rw->writer = NULL;
+  rw->upgrading = false;
+  rw->phase = 0;
+#ifdef LOCKSTAT
+  rw->stat = lockstat_register (name);
+#endif
+}
+
+/* Acquires RW for reading, sleeping as long as a writer holds it
+   or, for a newly arriving reader, as long as a writer is
+   waiting.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void rwlock_acquire_read (struct rwlock *rw)
+{
+  unsigned phase;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (rw->writer != thread_current ());
+
+  lock_acquire (&rw->lock);
+#ifdef LOCKSTAT
+  uint64_t start = timer_rdtsc ();
+  bool contended = false;
+#endif
+  phase = rw->phase;
+  while (rw->writer != NULL ||
+         ((rw->waiting_writers > 0 || rw->upgrading) && rw->phase == phase))
+    {
+#ifdef LOCKSTAT
+      contended = true;
+#endif
+      cond_wait (&rw->readers_ok, &rw->lock);
+    }
+  rw->readers++;
+#ifdef LOCKSTAT
+  lockstat_acquired (rw->stat, contended, timer_rdtsc () - start);
+#endif
+  lock_release (&rw->lock);
+}
+
+/* Releases read access to RW, which the current thread must
+   hold. */
+void rwlock_release_read (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  ASSERT (rw->readers > 0);
+  if (--rw->readers == 0)
+    cond_broadcast (&rw->writers_ok, &rw->lock);
+  lock_release (&rw->lock);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it and no reader is waiting to upgrade.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void rwlock_acquire_write (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (rw->writer != thread_current ());
+
+  lock_acquire (&rw->lock);
+#ifdef LOCKSTAT
+  uint64_t start = timer_rdtsc ();
+  bool contended = false;
+#endif
+  rw->waiting_writers++;
+  while (rw->writer != NULL || rw->readers > 0 || rw->upgrading)
+    {
+#ifdef LOCKSTAT
+      contended = true;
+#endif
+      cond_wait (&rw->writers_ok, &rw->lock);
+    }
+  rw->waiting_writers--;
+  rw->writer = thread_current ();
+#ifdef LOCKSTAT
+  rw->acquired_at = timer_rdtsc ();
+  lockstat_acquired (rw->stat, contended, rw->acquired_at - start);
+#endif
+  lock_release (&rw->lock);
+}
+
+/* Releases write access to RW, which the current thread must
+   hold.  Readers that were waiting are admitted first; otherwise
+   the next writer is. */
+void rwlock_release_write (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (rwlock_held_for_write (rw));
+
+  lock_acquire (&rw->lock);
+#ifdef LOCKSTAT
+  lockstat_released (rw->stat, timer_rdtsc () - rw->acquired_at);
+#endif
+  rw->writer = NULL;
+  rw->phase++;
+  if (!list_empty (&rw->readers_ok.waiters))
+    cond_broadcast (&rw->readers_ok, &rw->lock);
+  else
+    cond_broadcast (&rw->writers_ok, &rw->lock);
+  lock_release (&rw->lock);
+}
+
+/* Converts the current thread's read access to RW into write
+   access, sleeping until the other readers have left.  The
+   upgrading reader goes ahead of any waiting writers.
+
+   If another reader is already waiting to upgrade, the two could
+   only deadlock, so this function instead returns false at once,
+   with read access still held.  The caller must then release
+   read access and call rwlock_acquire_write(), and must assume
+   that the data may have changed in between. */
+bool rwlock_try_upgrade (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+
+  lock_acquire (&rw->lock);
+  ASSERT (rw->readers > 0);
+  if (rw->upgrading)
+    {
+      lock_release (&rw->lock);
+      return false;
+    }
+
+  rw->upgrading = true;
+  rw->readers--;
+  while (rw->readers > 0)
+    cond_wait (&rw->writers_ok, &rw->lock);
+  rw->upgrading = false;
+  rw->writer = thread_current ();
+#ifdef LOCKSTAT
+  rw->acquired_at = timer_rdtsc ();
+#endif
+  lock_release (&rw->lock);
+  return true;
+}
+
+/* Converts the current thread's write access to RW into read
+   access, without letting any writer in between, and admits any
+   waiting readers alongside it. */
+void rwlock_downgrade (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (rwlock_held_for_write (rw));
+
+  lock_acquire (&rw->lock);
+#ifdef LOCKSTAT
+  lockstat_released (rw->stat, timer_rdtsc () - rw->acquired_at);
+#endif
+  rw->writer = NULL;
+  rw->readers++;
+  rw->phase++;
+  cond_broadcast (&rw->readers_ok, &rw->lock);
+  lock_release (&rw->lock);
+}
+
+/* Returns true if the current thread holds RW for writing, false
+   otherwise.  (There is no equivalent for read access, since
+   readers are not tracked individually.) */
+bool rwlock_held_for_write (const struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  return rw->writer == thread_current ();
+}
+
+/* State shared by rwlock_self_test() and its helper threads. */
+struct rwlock_test
+{
+  struct rwlock rw;        /* Lock under test. */
+  struct semaphore done;   /* Upped by each helper as it finishes. */
+  int value;               /* Protected by RW. */
+  int readers_inside;      /* Readers seen inside at once, at most. */
+  int readers_now;         /* Readers currently inside. */
+};
+
+#define RWLOCK_TEST_THREADS 4
+#define RWLOCK_TEST_ITERS 50
+
+static void rwlock_test_reader (void *);
+static void rwlock_test_writer (void *);
+
+/* Self-test for reader-writer locks.  Starts readers and writers
+   that contend for one lock, checking that writers exclude
+   everyone else, that readers share access, and that an upgrade
+   sees no intervening writer. */
+void rwlock_self_test (void)
+{
+  static struct rwlock_test test;
+  int i;
+
+  printf ("Testing reader-writer locks...");
+  rwlock_init (&test.rw);
+  sema_init (&test.done, 0);
+  test.value = 0;
+  test.readers_inside = test.readers_now = 0;
+
+  for (i = 0; i < RWLOCK_TEST_THREADS; i++)
+    {
+      thread_create ("rw-reader", PRI_DEFAULT, rwlock_test_reader, &test);
+      thread_create ("rw-writer", PRI_DEFAULT, rwlock_test_writer, &test);
+    }
+  for (i = 0; i < 2 * RWLOCK_TEST_THREADS; i++)
+    sema_down (&test.done);
+  ASSERT (test.value == RWLOCK_TEST_THREADS * RWLOCK_TEST_ITERS * 2);
+
+  /* Upgrade and downgrade with no contention. */
+  rwlock_acquire_read (&test.rw);
+  if (!rwlock_try_upgrade (&test.rw))
+    PANIC ("uncontended upgrade failed");
+  ASSERT (rwlock_held_for_write (&test.rw));
+  rwlock_downgrade (&test.rw);
+  ASSERT (!rwlock_held_for_write (&test.rw));
+  rwlock_release_read (&test.rw);
+
+  printf ("done (up to %d readers at once).\n", test.readers_inside);
+}
+
+/* Reader thread for rwlock_self_test().  Reads the value twice
+   around a yield and checks that no writer got in between, then
+   upgrades to increment it. */
+static void rwlock_test_reader (void *test_)
+{
+  struct rwlock_test *test = test_;
+  int i;
+
+  for (i = 0; i < RWLOCK_TEST_ITERS; i++)
+    {
+      int before;
+
+      rwlock_acquire_read (&test->rw);
+      before = test->value;
+      if (++test->readers_now > test->readers_inside)
+        test->readers_inside = test->readers_now;
+      thread_yield ();
+      ASSERT (test->value == before);
+      test->readers_now--;
+
+      if (rwlock_try_upgrade (&test->rw))
+        {
+          ASSERT (test->value == before);
+          test->value++;
+          rwlock_release_write (&test->rw);
+        }
+      else
+        {
+          rwlock_release_read (&test->rw);
+          rwlock_acquire_write (&test->rw);
+          test->value++;
+          rwlock_release_write (&test->rw);
+        }
+    }
+  sema_up (&test->done);
+}
+
+/* Writer thread for rwlock_self_test().  Increments the value
+   non-atomically across a yield, which only works if writers
+   have exclusive access. */
+static void rwlock_test_writer (void *test_)
+{
+  struct rwlock_test *test = test_;
+  int i;
+
+  for (i = 0; i < RWLOCK_TEST_ITERS; i++)
+    {
+      int value;
+
+      rwlock_acquire_write (&test->rw);
+      ASSERT (test->readers_now == 0);
+      value = test->value;
+      thread_yield ();
+      test->value = value + 1;
+      rwlock_release_write (&test->rw);
+    }
+  sema_up (&test->done);
+}
+
+/* Initializes sequence lock SEQ. */
+void seqlock_init (struct seqlock *seq)
+{
+  ASSERT (seq != NULL);
+
+  seq->sequence = 0;
+}
+
+/* Begins a read-side critical section on SEQ and returns a value
+   to pass to seqlock_read_retry() at its end.  Typical use:
+
+     do
+       {
+         start = seqlock_read_begin (&seq);
+         ...copy the protected data...
+       }
+     while (seqlock_read_retry (&seq, start));
+
+   May be called from an interrupt handler, provided that the
+   writer cannot be the code the handler interrupted. */
+unsigned seqlock_read_begin (const struct seqlock *seq)
+{
+  unsigned start = *(volatile const unsigned *) &seq->sequence;
+  barrier ();
+  return start;
+}
+
+/* Returns true if the data read since seqlock_read_begin()
+   returned START may be inconsistent, because a write was in
+   progress at the start or happened since, in which case the
+   reader must try again. */
+bool seqlock_read_retry (const struct seqlock *seq, unsigned start)
+{
+  barrier ();
+  return (start & 1) != 0 ||
+         *(volatile const unsigned *) &seq->sequence != start;
+}
+
+/* Begins a write to the data protected by SEQ. */
+void seqlock_write_begin (struct seqlock *seq)
+{
+  ASSERT ((seq->sequence & 1) == 0);
+
+  seq->sequence++;
+  barrier ();
+}
+
+/* Ends a write to the data protected by SEQ. */
+void seqlock_write_end (struct seqlock *seq)
+{
+  ASSERT ((seq->sequence & 1) != 0);
+
+  barrier ();
+  seq->sequence++;
+}
+
+/* State shared by seqlock_self_test() and its writer thread.
+   The writer keeps A and B equal, but updates them one at a time
+   and yields in between, so unsynchronized readers would see
+   them differ. */
+struct seqlock_test
+{
+  struct seqlock seq;    /* Lock under test. */
+  struct semaphore done; /* Upped when the writer finishes. */
+  volatile int a, b;     /* Protected by SEQ. */
+  volatile bool stop;    /* Tells the writer to finish. */
+};
+
+static void seqlock_test_writer (void *);
+
+/* Self-test for sequence locks.  Reads a pair of values many
+   times while another thread rewrites them, checking that no
+   read that succeeds sees a torn update. */
+void seqlock_self_test (void)
+{
+  static struct seqlock_test test;
+  int i, retries = 0;
+
+  printf ("Testing sequence locks...");
+  seqlock_init (&test.seq);
+  sema_init (&test.done, 0);
+  test.a = test.b = 0;
+  test.stop = false;
+  thread_create ("seq-writer", PRI_DEFAULT, seqlock_test_writer, &test);
+
+  for (i = 0; i < 1000; i++)
+    {
+      unsigned start;
+      int a, b;
+
+      do
+        {
+          start = seqlock_read_begin (&test.seq);
+          a = test.a;
+          thread_yield ();
+          b = test.b;
+          retries++;
+        }
+      while (seqlock_read_retry (&test.seq, start));
+      ASSERT (a == b);
+    }
+  test.stop = true;
+  sema_down (&test.done);
+
+  printf ("done (%d retries).\n", retries - i);
+}
+
+/* Writer thread for seqlock_self_test().  Interrupts are turned
+   off across each write: the writer must not be preempted by a
+   reader in the middle, since readers spin rather than sleep. */
+static void seqlock_test_writer (void *test_)
+{
+  struct seqlock_test *test = test_;
+
+  while (!test->stop)
+    {
+      enum intr_level old_level = intr_disable ();
+      seqlock_write_begin (&test->seq);
+      test->a++;
+      test->b++;
+      seqlock_write_end (&test->seq);
+      intr_set_level (old_level);
+      thread_yield ();
+    }
+  sema_up (&test->done);
+}
@@ -3,6 +3,8 @@
 
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include "threads/lockstat.h"
 
 /* A counting semaphore. */
 struct semaphore
@@ -22,9 +24,15 @@ struct lock
 {
   struct thread *holder;      /* Thread holding lock. */
   struct semaphore semaphore; /* Binary semaphore controlling access. */
+  struct list_elem elem;      /* Element in holder's held_locks. */
+#ifdef LOCKSTAT
+  struct lockstat *stat;      /* Contention statistics. */
+  uint64_t acquired_at;       /* TSC when last acquired. */
+#endif
 };
 
 void lock_init (struct lock *);
+void lock_init_named (struct lock *, const char *name);
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
@@ -41,6 +49,60 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Reader-writer lock. */
+struct rwlock
+{
+  struct lock lock;            /* Protects the members below. */
+  struct condition readers_ok; /* Signaled when readers may enter. */
+  struct condition writers_ok; /* Signaled when a writer may enter. */
+  int readers;                 /* # of threads holding read access. */
+  int waiting_writers;         /* # of threads waiting for write access. */
+  struct thread *writer;       /* Thread holding write access, if any. */
+  bool upgrading;              /* A reader is waiting to upgrade. */
+  unsigned phase;              /* Incremented at each write release. */
+#ifdef LOCKSTAT
+  struct lockstat *stat;       /* Contention statistics. */
+  uint64_t acquired_at;        /* TSC when last acquired for writing. */
+#endif
+};
+
+void rwlock_init (struct rwlock *);
+void rwlock_init_named (struct rwlock *, const char *name);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_try_upgrade (struct rwlock *);
+void rwlock_downgrade (struct rwlock *);
+bool rwlock_held_for_write (const struct rwlock *);
+void rwlock_self_test (void);
+
+/* Sequence lock, for small, read-mostly data.  Readers never
+   block or write shared memory: they retry if a writer was
+   active while they read.  Writers must already exclude one
+   another, e.g. by being an interrupt handler or by holding a
+   lock, and must not sleep between seqlock_write_begin() and
+   seqlock_write_end(). */
+struct seqlock
+{
+  unsigned sequence; /* Odd while a write is in progress. */
+};
+
+void seqlock_init (struct seqlock *);
+unsigned seqlock_read_begin (const struct seqlock *);
+bool seqlock_read_retry (const struct seqlock *, unsigned start);
+void seqlock_write_begin (struct seqlock *);
+void seqlock_write_end (struct seqlock *);
+void seqlock_self_test (void);
+
+#ifdef LOCKSTAT
+/* With lock statistics enabled, locks initialized without a name
+   are named after the file and expression that initialized them,
+   e.g. "vm/frame.c: &scan_lock". */
+#define lock_init(LOCK) lock_init_named (LOCK, __FILE__ ": " #LOCK)
+#define rwlock_init(RW) rwlock_init_named (RW, __FILE__ ": " #RW)
+#endif
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
@@ -5,19 +5,22 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/flags.h"
+#include "threads/fpu.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
+#include "threads/workqueue.h"
 #include "threads/vaddr.h"
 #include "lib/kernel/stdio.h"
 #include "threads/malloc.h"
+#include "threads/fixed-point.h"
+#include "devices/timer.h"
 #include "userprog/process.h"
 #ifdef USERPROG
 #include "userprog/process.h"
-#include "filesys/filesys.h"
-#include "filesys/file.h"
 #endif
 
 /* Random value for struct thread's `magic' member.
@@ -25,9 +28,18 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Number of distinct thread priorities. */
+#define PRI_CNT (PRI_MAX - PRI_MIN + 1)
+
+/* Run queues of processes in THREAD_READY state, that is,
+   processes that are ready to run but not actually running.
+   There is one FIFO queue per priority, and bit P of
+   ready_bitmap is set if and only if ready_queues[P] is
+   non-empty, so the highest-priority ready thread can be found
+   with a single bit scan. */
+static struct list ready_queues[PRI_CNT];
+static uint64_t ready_bitmap;
+static int ready_cnt; /* Total threads in all run queues. */
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
@@ -50,13 +62,24 @@ struct kernel_thread_frame
   void *aux;             /* Auxiliary data for function. */
 };
 
+/* Pages of dead threads kept for reuse by thread_create(), which
+   saves a trip through palloc and zeroing a whole page.  Only
+   the struct thread header needs to be reset, and init_thread()
+   does that.  Given back to palloc under memory pressure. */
+#define THREAD_CACHE_MAX 16
+static struct thread *thread_cache[THREAD_CACHE_MAX];
+static size_t thread_cache_cnt;
+
 /* Statistics. */
+static long long thread_cache_hits;   /* # of pages reused. */
+static long long thread_cache_misses; /* # of pages from palloc. */
 static long long idle_ticks;   /* # of timer ticks spent idle. */
 static long long kernel_ticks; /* # of timer ticks in kernel threads. */
 static long long user_ticks;   /* # of timer ticks in user programs. */
 
 /* Scheduling. */
 #define TIME_SLICE 4          /* # of timer ticks to give each thread. */
+#define DONATION_DEPTH_MAX 8  /* Max lock holders a donation passes. */
 static unsigned thread_ticks; /* # of timer ticks since last yield. */
 
 /* If false (default), use round-robin scheduler.
@@ -64,6 +87,26 @@ static unsigned thread_ticks; /* # of timer ticks since last yield. */
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* Multi-level feedback queue scheduler state. */
+#define MLFQS_PRI_INTERVAL 4  /* # of ticks between priority updates. */
+static fixed_point load_avg;  /* Estimated # of ready threads, 1 min. */
+
+/* Threads whose recent_cpu has changed since priorities were
+   last recomputed.  Between the once-per-second updates only
+   the running thread's recent_cpu changes, so this list is
+   usually one or two threads long, and the periodic priority
+   update touches only its members. */
+static struct list mlfqs_dirty_list;
+
+/* The once-per-second recent_cpu decay touches every thread, so
+   it is spread over several ticks, MLFQS_DECAY_BATCH threads at a
+   time, to keep the timer interrupt short.  DECAY_CURSOR is the
+   next thread in all_list to decay by MLFQS_DECAY, or a null
+   pointer if no pass is in progress. */
+#define MLFQS_DECAY_BATCH 16
+static struct list_elem *decay_cursor;
+static fixed_point mlfqs_decay;
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
@@ -72,9 +115,23 @@ static struct thread *next_thread_to_run (void);
 static void init_thread (struct thread *, const char *name, int priority);
 static bool is_thread (struct thread *) UNUSED;
 static void *alloc_frame (struct thread *, size_t size);
+static void ready_queue_push (struct thread *);
+static void ready_queue_remove (struct thread *);
+static int ready_max_priority (void);
+static void set_effective_priority (struct thread *, int priority);
+static void mlfqs_tick (struct thread *cur);
+static int mlfqs_priority (const struct thread *);
+static void mlfqs_update_thread (struct thread *);
+static void all_list_remove (struct thread *);
 static void schedule (void);
+static void thread_account (struct thread *);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
+static work_func reap_thread;
+static struct thread *thread_page_alloc (void);
+static void thread_discard (struct thread *);
+static bool thread_cache_put (struct thread *);
+static palloc_reclaim_func thread_cache_reclaim;
 
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
@@ -91,11 +148,17 @@ static tid_t allocate_tid (void);
    finishes. */
 void thread_init (void)
 {
+  int i;
+
   ASSERT (intr_get_level () == INTR_OFF);
 
   lock_init (&tid_lock);
-  list_init (&ready_list);
+  for (i = 0; i < PRI_CNT; i++)
+    list_init (&ready_queues[i]);
   list_init (&all_list);
+  list_init (&mlfqs_dirty_list);
+  process_table_init ();
+  palloc_set_reclaim (thread_cache_reclaim);
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
@@ -121,12 +184,17 @@ void thread_start (void)
 }
 
 /* Called by the timer interrupt handler at each timer tick.
-   Thus, this function runs in an external interrupt context. */
-void thread_tick (void)
+   USER is true if the tick interrupted user code.  Thus, this
+   function runs in an external interrupt context. */
+void thread_tick (bool user)
 {
   struct thread *t = thread_current ();
 
   /* Update statistics. */
+  if (user)
+    t->user_ticks++;
+  else
+    t->kernel_ticks++;
   if (t == idle_thread)
     idle_ticks++;
 #ifdef USERPROG
@@ -136,16 +204,123 @@ void thread_tick (void)
   else
     kernel_ticks++;
 
+  if (thread_mlfqs)
+    mlfqs_tick (t);
+
   /* Enforce preemption. */
   if (++thread_ticks >= TIME_SLICE)
     intr_yield_on_return ();
 }
 
+/* Updates the multi-level feedback queue scheduler's statistics
+   for a timer tick in which CUR was running, and recomputes
+   priorities when they are due.  Runs in the timer interrupt,
+   with interrupts off, so the work done here is kept small:
+   each tick charges only CUR, every MLFQS_PRI_INTERVAL ticks
+   only the threads on mlfqs_dirty_list are revisited, and the
+   once-per-second decay of every thread is done a batch of
+   threads per tick. */
+static void mlfqs_tick (struct thread *cur)
+{
+  int64_t now = timer_ticks ();
+
+  ASSERT (intr_context ());
+
+  if (cur != idle_thread)
+    {
+      cur->recent_cpu = fp_add_int (cur->recent_cpu, 1);
+      if (!cur->mlfqs_dirty)
+        {
+          cur->mlfqs_dirty = true;
+          list_push_back (&mlfqs_dirty_list, &cur->mlfqs_elem);
+        }
+    }
+
+  if (now % TIMER_FREQ == 0)
+    {
+      int ready_threads = ready_cnt + (cur != idle_thread ? 1 : 0);
+      fixed_point twice_load;
+
+      /* load_avg = (59/60) * load_avg + (1/60) * ready_threads. */
+      load_avg = fp_add (fp_div_int (fp_mul_int (load_avg, 59), 60),
+                         fp_div_int (fp_from_int (ready_threads), 60));
+
+      /* Start a pass of recent_cpu = decay * recent_cpu + nice,
+         where decay = (2 * load_avg) / (2 * load_avg + 1). */
+      twice_load = fp_mul_int (load_avg, 2);
+      mlfqs_decay = fp_div (twice_load, fp_add_int (twice_load, 1));
+      decay_cursor = list_begin (&all_list);
+    }
+
+  /* Decay the next batch of threads and recompute their
+     priorities. */
+  if (decay_cursor != NULL)
+    {
+      int n;
+
+      for (n = 0; n < MLFQS_DECAY_BATCH && decay_cursor != list_end (&all_list);
+           n++)
+        {
+          struct thread *t = list_entry (decay_cursor, struct thread, allelem);
+          decay_cursor = list_next (decay_cursor);
+          if (t == idle_thread)
+            continue;
+          t->recent_cpu =
+              fp_add_int (fp_mul (mlfqs_decay, t->recent_cpu), t->nice);
+          mlfqs_update_thread (t);
+        }
+      if (decay_cursor == list_end (&all_list))
+        decay_cursor = NULL;
+    }
+
+  /* Recompute priorities of threads whose recent_cpu changed. */
+  if (now % MLFQS_PRI_INTERVAL == 0)
+    while (!list_empty (&mlfqs_dirty_list))
+      {
+        struct thread *t = list_entry (list_pop_front (&mlfqs_dirty_list),
+                                       struct thread, mlfqs_elem);
+        t->mlfqs_dirty = false;
+        mlfqs_update_thread (t);
+      }
+
+  if (ready_bitmap != 0 && ready_max_priority () > cur->priority)
+    intr_yield_on_return ();
+}
+
+/* Returns the priority the multi-level feedback queue scheduler
+   assigns to T:
+   PRI_MAX - (recent_cpu / 4) - (nice * 2), clamped to the valid
+   range. */
+static int mlfqs_priority (const struct thread *t)
+{
+  int priority =
+      PRI_MAX - fp_to_int (fp_div_int (t->recent_cpu, 4)) - t->nice * 2;
+
+  if (priority < PRI_MIN)
+    return PRI_MIN;
+  if (priority > PRI_MAX)
+    return PRI_MAX;
+  return priority;
+}
+
+/* Recomputes T's priority under the multi-level feedback queue
+   scheduler, moving T between run queues if it is ready.
+   Interrupts must be off. */
+static void mlfqs_update_thread (struct thread *t)
+{
+  int priority = mlfqs_priority (t);
+
+  t->base_priority = priority;
+  set_effective_priority (t, priority);
+}
+
 /* Prints thread statistics. */
 void thread_print_stats (void)
 {
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+  printf ("Thread: %lld pages reused, %lld pages allocated\n",
+          thread_cache_hits, thread_cache_misses);
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -160,9 +335,8 @@ void thread_print_stats (void)
    scheduled.  Use a semaphore or some other form of
    synchronization if you need to ensure ordering.
 
-   The code provided sets the new thread's `priority' member to
-   PRIORITY, but no actual priority scheduling is implemented.
-   Priority scheduling is the goal of Problem 1-3. */
+   If the new thread has a higher priority than the running
+   thread, the running thread yields to it before returning. */
 tid_t thread_create (const char *name, int priority, thread_func *function,
                      void *aux)
 {
@@ -175,13 +349,22 @@ tid_t thread_create (const char *name, int priority, thread_func *function,
   ASSERT (function != NULL);
 
   /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  t = thread_page_alloc ();
   if (t == NULL)
     return TID_ERROR;
 
   /* Initialize thread. */
   init_thread (t, name, priority);
   tid = t->tid = allocate_tid ();
+  if (thread_mlfqs)
+    {
+      /* Inherit the creator's scheduling history, so that a
+         CPU hog cannot escape its penalty by spawning threads. */
+      struct thread *cur = thread_current ();
+      t->nice = cur->nice;
+      t->recent_cpu = cur->recent_cpu;
+      t->priority = t->base_priority = mlfqs_priority (t);
+    }
   hash_init(&t->pages, page_hash, page_less, NULL);
 
 
@@ -202,30 +385,21 @@ tid_t thread_create (const char *name, int priority, thread_func *function,
 
   t->parent = thread_current (); // Creating thread is parent of new thread
 
-  // Add new thread to children struct of parent
-  struct child *child = malloc (sizeof (struct child));
-  child->child_thread = t;
-  child->exit_status = -1;
-  child->pid = tid;
-  sema_init(&child->exited, 0);
-  list_push_front (&thread_current()->children, &child->elem);
-
-  t->fd_table = (struct file **) palloc_get_page(PAL_USER | PAL_ZERO);
-  if (t->fd_table == NULL){
-    free(child);
-    palloc_free_page(t);
+  if (!fd_table_init (&t->fds)){
+    thread_discard (t);
     return TID_ERROR;
   }
-  
-  // Deny writes to currently executing file
-  if (strcmp("idle", name)){
-    t->fd_table[0] = filesys_open(name);
-    if (t->fd_table[0] != NULL)
-      file_deny_write(t->fd_table[0]);
+
+  // Record new thread in the process table, as a child of ours
+  if (!process_register (t)){
+    fd_table_destroy (&t->fds);
+    thread_discard (t);
+    return TID_ERROR;
   }
 
   /* Add to run queue. */
   thread_unblock (t);
+  thread_preempt ();
 
   return tid;
 }
@@ -249,10 +423,14 @@ void thread_block (void)
    This is an error if T is not blocked.  (Use thread_yield() to
    make the running thread ready.)
 
-   This function does not preempt the running thread.  This can
-   be important: if the caller had disabled interrupts itself,
-   it may expect that it can atomically unblock a thread and
-   update other data. */
+   When called from a kernel thread, this function does not
+   preempt the running thread.  This can be important: if the
+   caller had disabled interrupts itself, it may expect that it
+   can atomically unblock a thread and update other data.  Call
+   thread_preempt() afterward to give up the CPU if T should run
+   instead.  When called from an external interrupt handler, a
+   higher-priority T preempts the running thread as soon as the
+   interrupt returns. */
 void thread_unblock (struct thread *t)
 {
   enum intr_level old_level;
@@ -261,11 +439,34 @@ void thread_unblock (struct thread *t)
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
-  list_push_back (&ready_list, &t->elem);
+  thread_account (t);
+  ready_queue_push (t);
   t->status = THREAD_READY;
+  if (intr_context () && t->priority > thread_current ()->priority)
+    intr_yield_on_return ();
   intr_set_level (old_level);
 }
 
+/* Yields the CPU if a ready thread has a higher priority than
+   the running thread.  From an external interrupt handler, the
+   yield is deferred until the interrupt returns.  Does nothing
+   if called from a kernel thread with interrupts disabled, since
+   such a caller is relying on not being preempted. */
+void thread_preempt (void)
+{
+  enum intr_level old_level = intr_disable ();
+  bool yield = (ready_bitmap != 0 &&
+                ready_max_priority () > thread_current ()->priority);
+  intr_set_level (old_level);
+
+  if (!yield)
+    return;
+  if (intr_context ())
+    intr_yield_on_return ();
+  else if (old_level == INTR_ON)
+    thread_yield_preempted ();
+}
+
 /* Returns the name of the running thread. */
 const char *thread_name (void) { return thread_current ()->name; }
 
@@ -299,12 +500,15 @@ void thread_exit (void)
 #ifdef USERPROG
   process_exit ();
 #endif
+  fpu_exit ();
 
   /* Remove thread from all threads list, set our status to dying,
      and schedule another process.  That process will destroy us
      when it calls thread_schedule_tail(). */
   intr_disable ();
-  list_remove (&thread_current ()->allelem);
+  all_list_remove (thread_current ());
+  if (thread_current ()->mlfqs_dirty)
+    list_remove (&thread_current ()->mlfqs_elem);
   thread_current ()->status = THREAD_DYING;
   schedule ();
   NOT_REACHED ();
@@ -321,12 +525,62 @@ void thread_yield (void)
 
   old_level = intr_disable ();
   if (cur != idle_thread)
-    list_push_back (&ready_list, &cur->elem);
+    ready_queue_push (cur);
   cur->status = THREAD_READY;
   schedule ();
   intr_set_level (old_level);
 }
 
+/* Yields the CPU because a higher-priority thread is ready or the
+   running thread's time slice expired.  Unlike thread_yield(),
+   the switch is counted as involuntary. */
+void thread_yield_preempted (void)
+{
+  thread_current ()->preempted = true;
+  thread_yield ();
+}
+
+/* Fills in *STATS with the CPU and scheduling statistics of the
+   thread with identifier TID.  Returns false if there is no such
+   thread. */
+bool thread_get_stats (tid_t tid, struct procstat *stats)
+{
+  struct list_elem *e;
+  enum intr_level old_level;
+  bool found = false;
+
+  old_level = intr_disable ();
+  for (e = list_begin (&all_list); e != list_end (&all_list);
+       e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, allelem);
+      if (t->tid == tid)
+        {
+          uint64_t runnable = t->runnable_cycles;
+          uint64_t blocked = t->blocked_cycles;
+          uint64_t now = timer_rdtsc ();
+
+          /* Include time in the current state. */
+          if (t->status == THREAD_READY)
+            runnable += now - t->state_tsc;
+          else if (t->status == THREAD_BLOCKED)
+            blocked += now - t->state_tsc;
+
+          stats->user_ticks = t->user_ticks;
+          stats->kernel_ticks = t->kernel_ticks;
+          stats->voluntary_switches = t->voluntary_switches;
+          stats->involuntary_switches = t->involuntary_switches;
+          stats->runnable_ns = timer_tsc_to_ns (runnable);
+          stats->blocked_ns = timer_tsc_to_ns (blocked);
+          found = true;
+          break;
+        }
+    }
+  intr_set_level (old_level);
+
+  return found;
+}
+
 /* Invoke function 'func' on all threads, passing along 'aux'.
    This function must be called with interrupts off. */
 void thread_foreach (thread_action_func *func, void *aux)
@@ -342,39 +596,130 @@ void thread_foreach (thread_action_func *func, void *aux)
     }
 }
 
-/* Sets the current thread's priority to NEW_PRIORITY. */
+/* Sets the current thread's base priority to NEW_PRIORITY.  The
+   effective priority stays higher while donations outrank it.
+   If the current thread no longer has the highest priority,
+   yields.  Ignored under the multi-level feedback queue
+   scheduler, which computes priorities itself. */
 void thread_set_priority (int new_priority)
 {
-  thread_current ()->priority = new_priority;
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (PRI_MIN <= new_priority && new_priority <= PRI_MAX);
+
+  if (thread_mlfqs)
+    return;
+
+  old_level = intr_disable ();
+  cur->base_priority = new_priority;
+  thread_recompute_priority (cur);
+  intr_set_level (old_level);
+
+  thread_preempt ();
+}
+
+/* Donates DONOR's priority along the chain of lock holders
+   starting with the holder of DONOR->waiting_lock.  Each holder
+   that is blocked on another lock passes the donation on to
+   that lock's holder, up to DONATION_DEPTH_MAX links, so that
+   nested locking cannot make the walk unbounded.  Interrupts
+   must be off. */
+void thread_donate_priority (struct thread *donor)
+{
+  struct lock *lock = donor->waiting_lock;
+  int priority = donor->priority;
+  int depth;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (thread_mlfqs)
+    return;
+
+  for (depth = 0; lock != NULL && depth < DONATION_DEPTH_MAX; depth++)
+    {
+      struct thread *holder = lock->holder;
+      if (holder == NULL || holder->priority >= priority)
+        break;
+      set_effective_priority (holder, priority);
+      lock = holder->waiting_lock;
+    }
+}
+
+/* Recomputes T's effective priority as the maximum of its base
+   priority and the priorities of the threads waiting on locks it
+   holds.  Called when T releases a lock or changes its base
+   priority.  Interrupts must be off. */
+void thread_recompute_priority (struct thread *t)
+{
+  int priority = t->base_priority;
+  struct list_elem *e, *w;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!thread_mlfqs)
+    for (e = list_begin (&t->held_locks); e != list_end (&t->held_locks);
+         e = list_next (e))
+      {
+        struct lock *lock = list_entry (e, struct lock, elem);
+        struct list *waiters = &lock->semaphore.waiters;
+
+        for (w = list_begin (waiters); w != list_end (waiters);
+             w = list_next (w))
+          {
+            struct thread *donor = list_entry (w, struct thread, elem);
+            if (donor->priority > priority)
+              priority = donor->priority;
+          }
+      }
+
+  set_effective_priority (t, priority);
 }
 
 /* Returns the current thread's priority. */
 int thread_get_priority (void) { return thread_current ()->priority; }
 
-/* Sets the current thread's nice value to NICE. */
-void thread_set_nice (int nice UNUSED)
-{ /* Not yet implemented. */
+/* Sets the current thread's nice value to NICE and recomputes
+   its priority, yielding if it no longer has the highest
+   priority. */
+void thread_set_nice (int nice)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (NICE_MIN <= nice && nice <= NICE_MAX);
+
+  old_level = intr_disable ();
+  cur->nice = nice;
+  if (thread_mlfqs)
+    mlfqs_update_thread (cur);
+  intr_set_level (old_level);
+
+  thread_preempt ();
 }
 
 /* Returns the current thread's nice value. */
-int thread_get_nice (void)
-{
-  /* Not yet implemented. */
-  return 0;
-}
+int thread_get_nice (void) { return thread_current ()->nice; }
 
 /* Returns 100 times the system load average. */
 int thread_get_load_avg (void)
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int load_avg_100 = fp_round (fp_mul_int (load_avg, 100));
+  intr_set_level (old_level);
+
+  return load_avg_100;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int thread_get_recent_cpu (void)
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int recent_cpu_100 =
+      fp_round (fp_mul_int (thread_current ()->recent_cpu, 100));
+  intr_set_level (old_level);
+
+  return recent_cpu_100;
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
@@ -383,9 +728,9 @@ int thread_get_recent_cpu (void)
    thread_start().  It will be scheduled once initially, at which
    point it initializes idle_thread, "up"s the semaphore passed
    to it to enable thread_start() to continue, and immediately
-   blocks.  After that, the idle thread never appears in the
-   ready list.  It is returned by next_thread_to_run() as a
-   special case when the ready list is empty. */
+   blocks.  After that, the idle thread never appears in a run
+   queue.  It is returned by next_thread_to_run() as a special
+   case when every run queue is empty. */
 static void idle (void *idle_started_ UNUSED)
 {
   struct semaphore *idle_started = idle_started_;
@@ -409,7 +754,11 @@ static void idle (void *idle_started_ UNUSED)
          time.
 
          See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
-         7.11.1 "HLT Instruction". */
+         7.11.1 "HLT Instruction".
+
+         In tickless mode, first stop the periodic timer interrupt
+         if nothing needs it soon. */
+      timer_idle_enter ();
       asm volatile ("sti; hlt" : : : "memory");
     }
 }
@@ -457,7 +806,9 @@ static void init_thread (struct thread *t, const char *name, int priority)
   t->status = THREAD_BLOCKED;
   strlcpy (t->name, name, sizeof t->name);
   t->stack = (uint8_t *) t + PGSIZE;
-  t->priority = priority;
+  t->priority = t->base_priority = priority;
+  list_init (&t->held_locks);
+  t->state_tsc = timer_rdtsc ();
   t->magic = THREAD_MAGIC;
 
   old_level = intr_disable ();
@@ -480,17 +831,86 @@ static void *alloc_frame (struct thread *t, size_t size)
   return t->stack;
 }
 
+/* Appends T to the run queue for its priority and marks that
+   queue non-empty.  Interrupts must be off. */
+static void ready_queue_push (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  list_push_back (&ready_queues[t->priority], &t->elem);
+  ready_bitmap |= (uint64_t) 1 << t->priority;
+  ready_cnt++;
+}
+
+/* Removes ready thread T from its run queue, marking the queue
+   empty if T was its last thread.  Interrupts must be off. */
+static void ready_queue_remove (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->status == THREAD_READY);
+
+  list_remove (&t->elem);
+  if (list_empty (&ready_queues[t->priority]))
+    ready_bitmap &= ~((uint64_t) 1 << t->priority);
+  ready_cnt--;
+}
+
+/* Sets T's effective priority to PRIORITY, moving T to the
+   matching run queue if it is ready.  Interrupts must be off. */
+static void set_effective_priority (struct thread *t, int priority)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
+
+  if (t->priority == priority)
+    return;
+  if (t->status == THREAD_READY)
+    {
+      ready_queue_remove (t);
+      t->priority = priority;
+      ready_queue_push (t);
+    }
+  else
+    t->priority = priority;
+}
+
+/* Returns the highest priority with a non-empty run queue.
+   At least one run queue must be non-empty.  Interrupts must be
+   off. */
+static int ready_max_priority (void)
+{
+  uint32_t high = ready_bitmap >> 32;
+  uint32_t low = ready_bitmap;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (ready_bitmap != 0);
+
+  if (high != 0)
+    return 63 - __builtin_clz (high);
+  return 31 - __builtin_clz (low);
+}
+
 /* Chooses and returns the next thread to be scheduled.  Should
-   return a thread from the run queue, unless the run queue is
-   empty.  (If the running thread can continue running, then it
-   will be in the run queue.)  If the run queue is empty, return
-   idle_thread. */
+   return the front thread of the highest-priority non-empty run
+   queue, unless all run queues are empty.  (If the running
+   thread can continue running, then it will be in a run queue.)
+   If all run queues are empty, return idle_thread. */
 static struct thread *next_thread_to_run (void)
 {
-  if (list_empty (&ready_list))
+  struct list *queue;
+  struct thread *t;
+  int priority;
+
+  if (ready_bitmap == 0)
     return idle_thread;
-  else
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+
+  priority = ready_max_priority ();
+  queue = &ready_queues[priority];
+  t = list_entry (list_pop_front (queue), struct thread, elem);
+  if (list_empty (queue))
+    ready_bitmap &= ~((uint64_t) 1 << priority);
+  ready_cnt--;
+  return t;
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -521,6 +941,9 @@ void thread_schedule_tail (struct thread *prev)
   /* Start new time slice. */
   thread_ticks = 0;
 
+  /* Make the FPU trap unless it holds our state. */
+  fpu_activate (cur);
+
 #ifdef USERPROG
   /* Activate the new address space. */
   process_activate ();
@@ -530,12 +953,113 @@ void thread_schedule_tail (struct thread *prev)
      thread.  This must happen late so that thread_exit() doesn't
      pull out the rug under itself.  (We don't free
      initial_thread because its memory was not obtained via
-     palloc().) */
+     palloc().)  Keep the page for reuse if the cache has room.
+     Otherwise, freeing it takes the palloc lock, so leave that to
+     a worker rather than do it in the middle of a context switch,
+     unless the work queues are not yet running. */
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread)
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+      if (!thread_cache_put (prev))
+        {
+          if (system_wq != NULL)
+            {
+              work_init (&prev->reap_work, reap_thread);
+              queue_work (system_wq, &prev->reap_work);
+            }
+          else
+            palloc_free_page (prev);
+        }
+    }
+}
+
+/* Frees the page of the dead thread whose reap_work is W. */
+static void reap_thread (struct work *w)
+{
+  palloc_free_page (list_entry (&w->elem, struct thread, reap_work.elem));
+}
+
+/* Returns a page for a new thread, from the cache of dead
+   threads' pages if possible.  The page is not zeroed. */
+static struct thread *thread_page_alloc (void)
+{
+  struct thread *t = NULL;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (thread_cache_cnt > 0)
+    {
+      t = thread_cache[--thread_cache_cnt];
+      thread_cache_hits++;
     }
+  intr_set_level (old_level);
+
+  if (t == NULL)
+    {
+      t = palloc_get_page (0);
+      if (t != NULL)
+        thread_cache_misses++;
+    }
+  return t;
+}
+
+/* Removes T from all_list, moving the recent_cpu decay pass past
+   it if T is next.  Interrupts must be off. */
+static void all_list_remove (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (decay_cursor == &t->allelem)
+    decay_cursor = list_next (decay_cursor);
+  list_remove (&t->allelem);
+}
+
+/* Undoes init_thread() for T, which thread_create() could not
+   finish creating, and gives its page back to the cache or to
+   palloc. */
+static void thread_discard (struct thread *t)
+{
+  enum intr_level old_level;
+  bool cached;
+
+  old_level = intr_disable ();
+  all_list_remove (t);
+  cached = thread_cache_put (t);
+  intr_set_level (old_level);
+
+  if (!cached)
+    palloc_free_page (t);
+}
+
+/* Adds dead thread T's page to the cache and returns true, or
+   returns false if the cache is full.  Interrupts must be off. */
+static bool thread_cache_put (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (thread_cache_cnt >= THREAD_CACHE_MAX)
+    return false;
+  thread_cache[thread_cache_cnt++] = t;
+  return true;
+}
+
+/* Frees every cached thread page, for palloc under memory
+   pressure.  Returns the number freed. */
+static size_t thread_cache_reclaim (size_t page_cnt UNUSED)
+{
+  struct thread *pages[THREAD_CACHE_MAX];
+  enum intr_level old_level;
+  size_t cnt, i;
+
+  old_level = intr_disable ();
+  cnt = thread_cache_cnt;
+  memcpy (pages, thread_cache, cnt * sizeof *pages);
+  thread_cache_cnt = 0;
+  intr_set_level (old_level);
+
+  for (i = 0; i < cnt; i++)
+    palloc_free_page (pages[i]);
+  return cnt;
 }
 
 /* Schedules a new process.  At entry, interrupts must be off and
@@ -555,11 +1079,37 @@ static void schedule (void)
   ASSERT (cur->status != THREAD_RUNNING);
   ASSERT (is_thread (next));
 
+  if (cur == idle_thread && next != idle_thread)
+    timer_idle_exit ();
+  TRACE (TRACE_SCHEDULE, next->tid, cur->status);
   if (cur != next)
-    prev = switch_threads (cur, next);
+    {
+      if (cur->status == THREAD_READY && cur->preempted)
+        cur->involuntary_switches++;
+      else
+        cur->voluntary_switches++;
+      cur->state_tsc = timer_rdtsc ();
+      thread_account (next);
+      prev = switch_threads (cur, next);
+    }
+  cur->preempted = false;
   thread_schedule_tail (prev);
 }
 
+/* Charges the time T has spent in its current state, ready or
+   blocked, to T's statistics, and starts timing its next state.
+   Called with interrupts off just before T leaves the state. */
+static void thread_account (struct thread *t)
+{
+  uint64_t now = timer_rdtsc ();
+
+  if (t->status == THREAD_READY)
+    t->runnable_cycles += now - t->state_tsc;
+  else if (t->status == THREAD_BLOCKED)
+    t->blocked_cycles += now - t->state_tsc;
+  t->state_tsc = now;
+}
+
 /* Returns a tid to use for a new thread. */
 static tid_t allocate_tid (void)
 {
@@ -4,8 +4,12 @@
 #include <debug.h>
 #include <list.h>
 #include <stdint.h>
+#include <procstat.h>
 #include "threads/synch.h"
+#include "threads/fixed-point.h"
+#include "threads/workqueue.h"
 #include <hash.h>
+#include "userprog/fdtable.h"
 
 
 /* States in a thread's life cycle. */
@@ -22,11 +26,17 @@ enum thread_status
 typedef int tid_t;
 #define TID_ERROR ((tid_t) -1) /* Error value for tid_t. */
 
-/* Thread priorities. */
+/* Thread priorities.  The scheduler keeps one run queue per
+   priority in a 64-bit bitmap, so there may be at most 64. */
 #define PRI_MIN 0      /* Lowest priority. */
 #define PRI_DEFAULT 31 /* Default priority. */
 #define PRI_MAX 63     /* Highest priority. */
 
+/* Thread niceness, for the multi-level feedback queue scheduler. */
+#define NICE_MIN -20    /* Nicest. */
+#define NICE_DEFAULT 0  /* Default niceness. */
+#define NICE_MAX 20     /* Least nice. */
+
 /* A kernel thread or user process.
 
    Each thread structure is stored in its own 4 kB page.  The
@@ -79,12 +89,14 @@ typedef int tid_t;
    value, triggering the assertion.  (So don't add elements below
    THREAD_MAGIC.)
 */
-/* The `elem' member has a dual purpose.  It can be an element in
-   the run queue (thread.c), or it can be an element in a
-   semaphore wait list (synch.c).  It can be used these two ways
-   only because they are mutually exclusive: only a thread in the
-   ready state is on the run queue, whereas only a thread in the
-   blocked state is on a semaphore wait list. */
+/* The `elem' member has a triple purpose.  It can be an element
+   in the run queue (thread.c), an element in a semaphore wait
+   list (synch.c), or an element in the timer's sleep list
+   (devices/timer.c).  It can be used these ways only because they
+   are mutually exclusive: only a thread in the ready state is on
+   the run queue, whereas only a thread in the blocked state is on
+   a semaphore wait list or the sleep list, and a blocked thread
+   waits for only one thing at a time. */
 struct thread
 {
   /* Owned by thread.c. */
@@ -92,23 +104,58 @@ struct thread
   enum thread_status status; /* Thread state. */
   char name[16];             /* Name (for debugging purposes). */
   uint8_t *stack;            /* Saved stack pointer. */
-  int priority;              /* Priority. */
+  int priority;              /* Effective priority, with donations. */
+  int base_priority;         /* Priority before donations. */
   struct list_elem allelem;  /* List element for all threads list. */
+  struct work reap_work;     /* Frees this thread once it has died. */
 
-  /* Shared between thread.c and synch.c. */
+  /* Shared between thread.c, synch.c and devices/timer.c. */
   struct list_elem elem; /* List element. */
 
+  /* Owned by thread.c, for the multi-level feedback queue
+     scheduler. */
+  int nice;                    /* Niceness. */
+  fixed_point recent_cpu;      /* Recent CPU time received. */
+  bool mlfqs_dirty;            /* On mlfqs_dirty_list? */
+  struct list_elem mlfqs_elem; /* Element in mlfqs_dirty_list. */
+
+  /* Shared between thread.c and synch.c. */
+  struct lock *waiting_lock; /* Lock being waited for, if any. */
+  struct list held_locks;    /* Locks held, for priority donation. */
+
+  /* Owned by devices/timer.c. */
+  int64_t wake_tick; /* Tick at which to wake from timer_sleep(). */
+
+  /* Owned by threads/fpu.c. */
+  void *fpu_area; /* FPU save area, or NULL if FPU never used. */
+
+  /* Owned by thread.c, for CPU and scheduling statistics. */
+  int64_t user_ticks;            /* Ticks taken in user mode. */
+  int64_t kernel_ticks;          /* Ticks taken in kernel mode. */
+  unsigned voluntary_switches;   /* Switches away by block or yield. */
+  unsigned involuntary_switches; /* Switches away by preemption. */
+  bool preempted;                /* Yielding because preempted? */
+  uint64_t state_tsc;            /* TSC at last change of status. */
+  uint64_t runnable_cycles;      /* TSC cycles spent ready. */
+  uint64_t blocked_cycles;       /* TSC cycles spent blocked. */
+
   struct thread* parent; // Pointer to parent thread
-  struct list children; // List of children threads & metadata
+  struct list children; // Process table entries of children
+  struct process *process; // Own process table entry
   struct hash pages;
   struct semaphore child_created; // Synchronize exec method
   bool success; // Was exec successful 
 
-  struct file** fd_table; // Map fd (index) to files
+  struct fd_table fds; // Open files, by descriptor
+  bool stdin_nonblock; // Reads from stdin return 0 instead of waiting
+  struct ring_sq *ring_sq; // Registered submission ring, in user memory
+  struct ring_cq *ring_cq; // Registered completion ring, in user memory
+  unsigned ring_entries; // Number of entries in each ring
 
 #ifdef USERPROG
   /* Owned by userprog/process.c. */
   uint32_t *pagedir; /* Page directory. */
+  struct exec_image *exec_image; /* Executable being run. */
 #endif
 
   /* Owned by thread.c. */
@@ -123,8 +170,9 @@ extern bool thread_mlfqs;
 void thread_init (void);
 void thread_start (void);
 
-void thread_tick (void);
+void thread_tick (bool user);
 void thread_print_stats (void);
+bool thread_get_stats (tid_t, struct procstat *);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
@@ -138,6 +186,8 @@ const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
+void thread_yield_preempted (void);
+void thread_preempt (void);
 
 /* Performs some operation on thread t, given auxiliary data AUX. */
 typedef void thread_action_func (struct thread *t, void *aux);
@@ -145,6 +195,8 @@ void thread_foreach (thread_action_func *, void *);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
+void thread_donate_priority (struct thread *);
+void thread_recompute_priority (struct thread *);
 
 int thread_get_nice (void);
 void thread_set_nice (int);
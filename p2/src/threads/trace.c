@@ -0,0 +1,129 @@
+#include "threads/trace.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Number of events the buffer holds. */
+size_t trace_event_cnt;
+
+/* True while tracepoints record events.  Set by trace_init(),
+   once the buffer exists, if trace_event_cnt is nonzero. */
+bool trace_enabled;
+
+/* Ring buffer of events.  EVENT_HEAD is the index of the slot for
+   the next event, and EVENT_TOTAL the number ever recorded. */
+static struct trace_event *events;
+static size_t event_head;
+static uint64_t event_total;
+
+/* Header written before the events.  All fields, like those of
+   the events, are little-endian. */
+struct trace_header
+{
+  char magic[4];       /* "PTRC". */
+  uint32_t version;    /* TRACE_VERSION. */
+  uint32_t event_size; /* sizeof (struct trace_event). */
+  uint32_t event_cnt;  /* Number of events that follow. */
+  uint64_t dropped;    /* Older events overwritten. */
+  uint64_t tsc_hz;     /* TSC frequency, for converting times. */
+};
+
+#define TRACE_VERSION 1
+
+static void dump_bytes (const void *, size_t);
+
+/* Allocates the event buffer and enables tracing, if requested.
+   Must be called after palloc_init(). */
+void trace_init (void)
+{
+  size_t page_cnt;
+
+  if (trace_event_cnt == 0)
+    return;
+
+  page_cnt = DIV_ROUND_UP (trace_event_cnt * sizeof *events, PGSIZE);
+  events = palloc_get_multiple (PAL_ZERO, page_cnt);
+  if (events == NULL)
+    PANIC ("trace: could not allocate %zu pages for %zu events",
+           page_cnt, trace_event_cnt);
+  trace_enabled = true;
+}
+
+/* Records an event of TYPE with arguments ARG0 and ARG1.  Use
+   the TRACE macro instead of calling this directly.  May be
+   called from any context. */
+void trace_record (enum trace_type type, uint32_t arg0, uint32_t arg1)
+{
+  enum intr_level old_level = intr_disable ();
+  struct trace_event *e = &events[event_head];
+
+  if (++event_head == trace_event_cnt)
+    event_head = 0;
+  event_total++;
+
+  e->tsc = timer_rdtsc ();
+  e->type = type;
+  e->tid = thread_current ()->tid;
+  e->arg[0] = arg0;
+  e->arg[1] = arg1;
+  intr_set_level (old_level);
+}
+
+/* Stops tracing and writes the header and events to the
+   console, hex-encoded between "Trace:" and "Trace end." lines,
+   in the format that utils/trace reads. */
+void trace_dump (void)
+{
+  struct trace_header h;
+  size_t cnt, first;
+
+  if (!trace_enabled)
+    return;
+  trace_enabled = false;
+
+  cnt = event_total < trace_event_cnt ? event_total : trace_event_cnt;
+  first = (event_head + trace_event_cnt - cnt) % trace_event_cnt;
+
+  memcpy (h.magic, "PTRC", sizeof h.magic);
+  h.version = TRACE_VERSION;
+  h.event_size = sizeof *events;
+  h.event_cnt = cnt;
+  h.dropped = event_total - cnt;
+  h.tsc_hz = timer_tsc_hz ();
+
+  printf ("Trace: %zu events, %" PRIu64 " overwritten.\n", cnt, h.dropped);
+  dump_bytes (&h, sizeof h);
+  if (first + cnt <= trace_event_cnt)
+    dump_bytes (events + first, cnt * sizeof *events);
+  else
+    {
+      dump_bytes (events + first, (trace_event_cnt - first) * sizeof *events);
+      dump_bytes (events, (first + cnt - trace_event_cnt) * sizeof *events);
+    }
+  printf ("Trace end.\n");
+}
+
+/* Prints the SIZE bytes at BUF as "trace-data" lines of hex. */
+static void dump_bytes (const void *buf_, size_t size)
+{
+  const uint8_t *buf = buf_;
+  char line[80];
+  size_t ofs;
+
+  for (ofs = 0; ofs < size; ofs += 32)
+    {
+      size_t n = size - ofs < 32 ? size - ofs : 32;
+      size_t i;
+
+      for (i = 0; i < n; i++)
+        snprintf (line + 2 * i, 3, "%02x", buf[ofs + i]);
+      printf ("trace-data %s\n", line);
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Event tracing.
+
+   Tracepoints record timestamped events into a ring buffer
+   allocated at boot, which is written out at power-off for
+   utils/trace to decode into a timeline.  Tracing is enabled by
+   kernel command-line option "-trace[=EVENTS]"; when it is off,
+   each tracepoint costs only a test of TRACE_ENABLED. */
+
+/* Event types.  utils/trace knows these by number, so add new
+   ones only at the end. */
+enum trace_type
+{
+  TRACE_SCHEDULE,       /* Context switch: next tid, prev status. */
+  TRACE_INTR_ENTER,     /* Interrupt entry: vector, eip. */
+  TRACE_INTR_EXIT,      /* Interrupt exit: vector. */
+  TRACE_SYSCALL_ENTER,  /* System call entry: number. */
+  TRACE_SYSCALL_EXIT,   /* System call exit: number, return value. */
+  TRACE_PAGE_FAULT,     /* Page fault: fault address, eip. */
+  TRACE_BLOCK_SUBMIT,   /* Block request: sector, 1 if write. */
+  TRACE_BLOCK_COMPLETE, /* Block request done: sector, 1 if write. */
+  TRACE_LOCK_BLOCK,     /* Blocking on a lock: lock, holder tid. */
+  TRACE_LOCK_WAKE,      /* Releasing a contended lock: lock, waiters. */
+  TRACE_TYPE_CNT
+};
+
+/* One event, as stored in the buffer and written out. */
+struct trace_event
+{
+  uint64_t tsc;    /* Time-stamp counter when recorded. */
+  uint32_t type;   /* An enum trace_type. */
+  int32_t tid;     /* Running thread. */
+  uint32_t arg[2]; /* Type-specific arguments. */
+};
+
+/* Number of events the buffer holds.  Nonzero enables tracing.
+   Set by kernel command-line option "-trace". */
+extern size_t trace_event_cnt;
+extern bool trace_enabled;
+
+/* Number of events kept if "-trace" gives no count. */
+#define TRACE_DEFAULT_CNT 16384
+
+void trace_init (void);
+void trace_record (enum trace_type, uint32_t arg0, uint32_t arg1);
+void trace_dump (void);
+
+/* Records an event of TYPE with arguments ARG0 and ARG1, if
+   tracing is enabled. */
+#define TRACE(TYPE, ARG0, ARG1)                                       \
+  do                                                                  \
+    {                                                                 \
+      if (__builtin_expect (trace_enabled, 0))                        \
+        trace_record (TYPE, (uint32_t) (ARG0), (uint32_t) (ARG1));    \
+    }                                                                 \
+  while (0)
+
+#endif /* threads/trace.h */
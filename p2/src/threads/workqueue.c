@@ -0,0 +1,335 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+
+/* Most works one worker takes from its queue at once.  A batch
+   holds consecutive works with the same function, so that one
+   wakeup of a worker runs all of them. */
+#define WORKQUEUE_BATCH_MAX 32
+
+/* Queue for general use. */
+struct workqueue *system_wq;
+
+/* All work queues, for statistics. */
+static struct list workqueue_list;
+
+/* Delayed works, ordered by ascending due tick.  Moved to their
+   queues by workqueue_tick(). */
+static struct list delayed_list;
+
+static thread_func worker;
+static list_less_func due_tick_less;
+static void enqueue (struct workqueue *, struct work *);
+
+/* Initializes the work queue system and creates system_wq.  Must
+   be called after malloc_init() and before the timer interrupt
+   can call workqueue_tick(). */
+void workqueue_init (void)
+{
+  list_init (&workqueue_list);
+  list_init (&delayed_list);
+  system_wq = workqueue_create ("system-wq", 1, PRI_DEFAULT);
+  if (system_wq == NULL)
+    PANIC ("could not create system work queue");
+}
+
+/* Creates and returns a work queue named NAME served by
+   WORKER_CNT worker threads at the given PRIORITY, or a null
+   pointer if memory is not available.  Work queues are never
+   destroyed.  NAME must remain valid as long as the kernel
+   runs. */
+struct workqueue *workqueue_create (const char *name, int worker_cnt,
+                                    int priority)
+{
+  struct workqueue *wq;
+  enum intr_level old_level;
+  int i;
+
+  ASSERT (worker_cnt > 0);
+  ASSERT (priority >= PRI_MIN && priority <= PRI_MAX);
+
+  wq = calloc (1, sizeof *wq);
+  if (wq == NULL)
+    return NULL;
+  wq->name = name;
+  list_init (&wq->pending);
+  sema_init (&wq->ready, 0);
+
+  old_level = intr_disable ();
+  list_push_back (&workqueue_list, &wq->elem);
+  intr_set_level (old_level);
+
+  for (i = 0; i < worker_cnt; i++)
+    if (thread_create (name, priority, worker, wq) == TID_ERROR)
+      PANIC ("could not create worker for %s", name);
+  return wq;
+}
+
+/* Initializes W to run FUNC when queued. */
+void work_init (struct work *w, work_func *func)
+{
+  ASSERT (w != NULL);
+  ASSERT (func != NULL);
+
+  w->func = func;
+  w->wq = NULL;
+  w->pending = false;
+  w->delayed = false;
+  w->due_tick = 0;
+}
+
+/* Queues W to run in WQ.  Returns true if successful, false if W
+   was already pending, in which case it will run only once.
+
+   May be called from an interrupt handler or with interrupts
+   off. */
+bool queue_work (struct workqueue *wq, struct work *w)
+{
+  enum intr_level old_level;
+  bool queued = false;
+
+  ASSERT (wq != NULL);
+  ASSERT (w != NULL);
+
+  old_level = intr_disable ();
+  if (!w->pending)
+    {
+      w->pending = true;
+      w->delayed = false;
+      w->due_tick = 0;
+      enqueue (wq, w);
+      queued = true;
+    }
+  intr_set_level (old_level);
+
+  return queued;
+}
+
+/* Queues W to run in WQ after at least TICKS timer ticks.
+   Returns true if successful, false if W was already pending.
+
+   May be called from an interrupt handler or with interrupts
+   off. */
+bool queue_delayed_work (struct workqueue *wq, struct work *w, int64_t ticks)
+{
+  enum intr_level old_level;
+  bool queued = false;
+
+  ASSERT (wq != NULL);
+  ASSERT (w != NULL);
+
+  if (ticks <= 0)
+    return queue_work (wq, w);
+
+  old_level = intr_disable ();
+  if (!w->pending)
+    {
+      w->pending = true;
+      w->delayed = true;
+      w->wq = wq;
+      w->due_tick = timer_ticks () + ticks;
+      list_insert_ordered (&delayed_list, &w->elem, due_tick_less, NULL);
+      queued = true;
+    }
+  intr_set_level (old_level);
+
+  return queued;
+}
+
+/* If W is delayed work whose delay has not yet expired, cancels
+   it and returns true.  Otherwise, returns false: W was not
+   pending, or is already queued to run. */
+bool cancel_delayed_work (struct work *w)
+{
+  enum intr_level old_level;
+  bool canceled = false;
+
+  ASSERT (w != NULL);
+
+  old_level = intr_disable ();
+  if (w->delayed)
+    {
+      list_remove (&w->elem);
+      w->delayed = false;
+      w->pending = false;
+      w->wq = NULL;
+      canceled = true;
+    }
+  intr_set_level (old_level);
+
+  return canceled;
+}
+
+/* A work that ups a semaphore, for flush_workqueue(). */
+struct flush_work
+{
+  struct work work;
+  struct semaphore done;
+};
+
+/* Ups the semaphore in the flush_work that contains W. */
+static void flush_work_func (struct work *w)
+{
+  struct flush_work *fw =
+      list_entry (&w->elem, struct flush_work, work.elem);
+  sema_up (&fw->done);
+}
+
+/* Waits until all the work queued in WQ so far has been taken
+   by a worker.  With a single worker, it has also finished
+   running.  Delayed work that is not yet due is not waited for.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler, nor by a worker of WQ. */
+void flush_workqueue (struct workqueue *wq)
+{
+  struct flush_work fw;
+
+  ASSERT (!intr_context ());
+
+  work_init (&fw.work, flush_work_func);
+  sema_init (&fw.done, 0);
+  queue_work (wq, &fw.work);
+  sema_down (&fw.done);
+}
+
+/* Moves delayed works that are due at tick NOW to their queues.
+   Called by the timer interrupt handler at each tick. */
+void workqueue_tick (int64_t now)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (!list_empty (&delayed_list))
+    {
+      struct work *w =
+          list_entry (list_front (&delayed_list), struct work, elem);
+      if (w->due_tick > now)
+        break;
+      list_pop_front (&delayed_list);
+      w->delayed = false;
+      enqueue (w->wq, w);
+    }
+}
+
+/* If any delayed work is outstanding, stores the tick at which
+   the earliest becomes due in *TICK and returns true.  Otherwise,
+   returns false.  Interrupts must be off. */
+bool workqueue_next_due (int64_t *tick)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (list_empty (&delayed_list))
+    return false;
+  *tick = list_entry (list_front (&delayed_list), struct work, elem)->due_tick;
+  return true;
+}
+
+/* Prints statistics for each work queue. */
+void workqueue_print_stats (void)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&workqueue_list); e != list_end (&workqueue_list);
+       e = list_next (e))
+    {
+      struct workqueue *wq = list_entry (e, struct workqueue, elem);
+      uint64_t latency_us =
+          wq->run_cnt > 0
+              ? timer_tsc_to_ns (wq->latency_cycles / wq->run_cnt) / 1000
+              : 0;
+      printf ("Work queue %s: %" PRIu64 " queued, %" PRIu64 " run in %"
+              PRIu64 " batches (max %u), %" PRIu64 " us average latency\n",
+              wq->name, wq->queued_cnt, wq->run_cnt, wq->batch_cnt,
+              wq->max_batch, latency_us);
+    }
+}
+
+/* Adds W, which must already be marked pending, to the end of
+   WQ's pending list and wakes a worker.  Interrupts must be
+   off. */
+static void enqueue (struct workqueue *wq, struct work *w)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  w->wq = wq;
+  w->queued_tsc = timer_rdtsc ();
+  list_push_back (&wq->pending, &w->elem);
+  wq->queued_cnt++;
+  sema_up (&wq->ready);
+}
+
+/* Worker thread body.  Repeatedly takes a batch of works from
+   the queue WQ_ and runs them. */
+static void worker (void *wq_)
+{
+  struct workqueue *wq = wq_;
+
+  for (;;)
+    {
+      struct list batch;
+      work_func *func = NULL;
+      unsigned n = 0, i;
+      uint64_t now;
+
+      sema_down (&wq->ready);
+
+      /* Take the first pending work and the ones right after it
+         that have the same function.  Each had its own "up" of
+         READY; consume those for the extra works taken, unless
+         another worker woke for them and found nothing. */
+      list_init (&batch);
+      intr_disable ();
+      now = timer_rdtsc ();
+      while (!list_empty (&wq->pending) && n < WORKQUEUE_BATCH_MAX)
+        {
+          struct work *w =
+              list_entry (list_front (&wq->pending), struct work, elem);
+          if (n > 0 && w->func != func)
+            break;
+          func = w->func;
+          list_pop_front (&wq->pending);
+          list_push_back (&batch, &w->elem);
+          wq->latency_cycles += now - w->queued_tsc;
+          n++;
+        }
+      for (i = 1; i < n; i++)
+        sema_try_down (&wq->ready);
+      if (n > 0)
+        {
+          wq->run_cnt += n;
+          wq->batch_cnt++;
+          if (n > wq->max_batch)
+            wq->max_batch = n;
+        }
+      intr_enable ();
+
+      /* Run the batch.  Each work is marked not pending before it
+         runs, so that it may queue itself again or free itself. */
+      while (!list_empty (&batch))
+        {
+          struct work *w =
+              list_entry (list_pop_front (&batch), struct work, elem);
+          enum intr_level old_level = intr_disable ();
+          w->pending = false;
+          w->wq = NULL;
+          intr_set_level (old_level);
+          w->func (w);
+        }
+    }
+}
+
+/* Orders delayed works by ascending due tick, keeping works due
+   at the same tick in the order they were queued. */
+static bool due_tick_less (const struct list_elem *a_,
+                           const struct list_elem *b_, void *aux UNUSED)
+{
+  const struct work *a = list_entry (a_, struct work, elem);
+  const struct work *b = list_entry (b_, struct work, elem);
+
+  return a->due_tick < b->due_tick;
+}
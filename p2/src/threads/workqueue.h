@@ -0,0 +1,68 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "threads/synch.h"
+
+/* Work queues.
+
+   A work queue runs deferred work in kernel worker threads, so
+   that interrupt handlers and other latency-critical paths can
+   hand off anything that need not happen right away.  Work is
+   described by a struct work, which the caller embeds in some
+   longer-lived object and initializes with work_init(). */
+
+struct work;
+struct workqueue;
+
+/* Runs deferred work W.  W is no longer queued when this is
+   called, so it may queue itself again or free its memory. */
+typedef void work_func (struct work *w);
+
+/* A piece of deferred work. */
+struct work
+{
+  struct list_elem elem;  /* Element in a queue's pending list. */
+  work_func *func;        /* Function to run. */
+  struct workqueue *wq;   /* Queue, while pending or delayed. */
+  bool pending;           /* Queued or delayed but not yet run? */
+  bool delayed;           /* On the delayed list, not yet queued? */
+  int64_t due_tick;       /* When a delayed work becomes pending. */
+  uint64_t queued_tsc;    /* When queued, for latency statistics. */
+};
+
+/* A work queue. */
+struct workqueue
+{
+  const char *name;          /* Name, for worker threads and stats. */
+  struct list pending;       /* Work waiting to run, in FIFO order. */
+  struct semaphore ready;    /* Upped once per work queued. */
+  struct list_elem elem;     /* Element in list of all queues. */
+
+  /* Statistics. */
+  uint64_t queued_cnt;       /* # of works queued. */
+  uint64_t run_cnt;          /* # of works run. */
+  uint64_t batch_cnt;        /* # of batches run. */
+  unsigned max_batch;        /* Largest batch run. */
+  uint64_t latency_cycles;   /* Total TSC cycles from queue to run. */
+};
+
+/* Queue for general use, served by one PRI_DEFAULT worker. */
+extern struct workqueue *system_wq;
+
+void workqueue_init (void);
+struct workqueue *workqueue_create (const char *name, int worker_cnt,
+                                    int priority);
+void workqueue_tick (int64_t now);
+bool workqueue_next_due (int64_t *tick);
+void workqueue_print_stats (void);
+
+void work_init (struct work *, work_func *);
+bool queue_work (struct workqueue *, struct work *);
+bool queue_delayed_work (struct workqueue *, struct work *, int64_t ticks);
+bool cancel_delayed_work (struct work *);
+void flush_workqueue (struct workqueue *);
+
+#endif /* threads/workqueue.h */
@@ -0,0 +1,270 @@
+#include "userprog/execcache.h"
+#include <debug.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+
+/* Executable image cache.
+
+   Programs tend to be run over and over, and loading one from
+   scratch means reading and checking its ELF headers and reading
+   every segment from disk.  Instead, load() keeps the result, an
+   exec_image, in this cache, keyed by the executable's inode
+   number, and later execs of the same file only build page
+   tables: read-only pages are mapped straight from the image,
+   shared by every process running it, and writable pages are
+   copied from it.
+
+   Writing to an executable, or freeing its inode, invalidates its
+   image.  Processes still running an invalidated image keep it
+   until they exit.
+
+   Cached pages come from the user pool.  Images that no process
+   is running are evicted, least recently used first, once the
+   cache holds more than EXEC_CACHE_PAGES pages, or when the user
+   pool runs out while load() is getting pages for a process's
+   segments or stack from exec_cache_get_page(). */
+
+/* Number of cached pages above which unused images are evicted. */
+#define EXEC_CACHE_PAGES 128
+
+static struct hash images;       /* Cached images, by inode number. */
+static struct list lru;          /* Cached images, most recent first. */
+static size_t cached_pages;      /* Pages held by cached images. */
+static struct lock cache_lock;   /* Protects all of the above. */
+
+static hash_hash_func image_hash;
+static hash_less_func image_less;
+static void image_destroy (struct exec_image *);
+static void uncache (struct exec_image *);
+static bool evict (void);
+
+/* Initializes the executable cache. */
+void exec_cache_init (void)
+{
+  hash_init (&images, image_hash, image_less, NULL);
+  list_init (&lru);
+  lock_init (&cache_lock);
+}
+
+/* Returns a new, uncached image of the executable with inode
+   number INUMBER, with room for MAX_SEGS segments, or a null
+   pointer if memory is short.  The caller holds the only
+   reference. */
+struct exec_image *exec_image_create (block_sector_t inumber, int max_segs)
+{
+  struct exec_image *image = calloc (1, sizeof *image);
+  if (image == NULL)
+    return NULL;
+  image->segs = calloc (max_segs > 0 ? max_segs : 1, sizeof *image->segs);
+  if (image->segs == NULL)
+    {
+      free (image);
+      return NULL;
+    }
+  image->inumber = inumber;
+  image->ref_cnt = 1;
+  return image;
+}
+
+/* Adds a segment of PAGE_CNT pages at UPAGE to IMAGE and returns
+   it, with all of its pages null (zero), or returns a null
+   pointer if memory is short.  The caller fills in the pages
+   with exec_cache_get_page(). */
+struct exec_segment *exec_image_add_segment (struct exec_image *image,
+                                             uint8_t *upage, size_t page_cnt,
+                                             bool writable)
+{
+  struct exec_segment *seg = &image->segs[image->seg_cnt];
+
+  seg->pages = calloc (page_cnt > 0 ? page_cnt : 1, sizeof *seg->pages);
+  if (seg->pages == NULL)
+    return NULL;
+  seg->upage = upage;
+  seg->page_cnt = page_cnt;
+  seg->writable = writable;
+  image->seg_cnt++;
+  return seg;
+}
+
+/* Returns a page from the user pool, evicting unused images if
+   the pool is empty, or a null pointer if none can be had. */
+void *exec_cache_get_page (void)
+{
+  void *page;
+
+  while ((page = palloc_get_page (PAL_USER)) == NULL)
+    {
+      bool evicted;
+
+      lock_acquire (&cache_lock);
+      evicted = evict ();
+      lock_release (&cache_lock);
+      if (!evicted)
+        return NULL;
+    }
+  return page;
+}
+
+/* Returns a new reference to the cached image of the executable
+   with inode number INUMBER, or a null pointer if there is
+   none. */
+struct exec_image *exec_cache_lookup (block_sector_t inumber)
+{
+  struct exec_image key;
+  struct hash_elem *e;
+  struct exec_image *image = NULL;
+
+  key.inumber = inumber;
+  lock_acquire (&cache_lock);
+  e = hash_find (&images, &key.hash_elem);
+  if (e != NULL)
+    {
+      image = hash_entry (e, struct exec_image, hash_elem);
+      image->ref_cnt++;
+      list_remove (&image->lru_elem);
+      list_push_front (&lru, &image->lru_elem);
+    }
+  lock_release (&cache_lock);
+  return image;
+}
+
+/* Adds IMAGE, which the caller holds the only reference to, to
+   the cache.  If another image of the same executable was cached
+   in the meantime, releases IMAGE and returns a new reference to
+   that one instead; otherwise returns IMAGE. */
+struct exec_image *exec_cache_insert (struct exec_image *image)
+{
+  struct hash_elem *e;
+  int i;
+
+  ASSERT (image->ref_cnt == 1 && !image->cached);
+
+  image->page_cnt = 0;
+  for (i = 0; i < image->seg_cnt; i++)
+    {
+      size_t j;
+      for (j = 0; j < image->segs[i].page_cnt; j++)
+        if (image->segs[i].pages[j] != NULL)
+          image->page_cnt++;
+    }
+
+  lock_acquire (&cache_lock);
+  e = hash_insert (&images, &image->hash_elem);
+  if (e != NULL)
+    {
+      struct exec_image *old = hash_entry (e, struct exec_image, hash_elem);
+      old->ref_cnt++;
+      lock_release (&cache_lock);
+      image_destroy (image);
+      return old;
+    }
+  image->cached = true;
+  list_push_front (&lru, &image->lru_elem);
+  cached_pages += image->page_cnt;
+  while (cached_pages > EXEC_CACHE_PAGES && evict ())
+    continue;
+  lock_release (&cache_lock);
+  return image;
+}
+
+/* Drops a reference to IMAGE, freeing it if it was the last and
+   IMAGE is no longer cached.  IMAGE may be null. */
+void exec_image_release (struct exec_image *image)
+{
+  bool destroy;
+
+  if (image == NULL)
+    return;
+  lock_acquire (&cache_lock);
+  ASSERT (image->ref_cnt > 0);
+  destroy = --image->ref_cnt == 0 && !image->cached;
+  lock_release (&cache_lock);
+  if (destroy)
+    image_destroy (image);
+}
+
+/* Removes the image of the executable with inode number INUMBER,
+   if any, from the cache, because the file changed. */
+void exec_cache_invalidate (block_sector_t inumber)
+{
+  struct exec_image key;
+  struct hash_elem *e;
+  struct exec_image *image = NULL;
+
+  key.inumber = inumber;
+  lock_acquire (&cache_lock);
+  e = hash_find (&images, &key.hash_elem);
+  if (e != NULL)
+    {
+      image = hash_entry (e, struct exec_image, hash_elem);
+      uncache (image);
+      if (image->ref_cnt > 0)
+        image = NULL;
+    }
+  lock_release (&cache_lock);
+  if (image != NULL)
+    image_destroy (image);
+}
+
+/* Removes IMAGE from the cache.  The cache lock must be held. */
+static void uncache (struct exec_image *image)
+{
+  ASSERT (lock_held_by_current_thread (&cache_lock));
+  ASSERT (image->cached);
+
+  hash_delete (&images, &image->hash_elem);
+  list_remove (&image->lru_elem);
+  cached_pages -= image->page_cnt;
+  image->cached = false;
+}
+
+/* Evicts and frees the least recently used image that no process
+   is running.  Returns true if successful, false if there is no
+   such image.  The cache lock must be held. */
+static bool evict (void)
+{
+  struct list_elem *e;
+
+  for (e = list_rbegin (&lru); e != list_rend (&lru); e = list_prev (e))
+    {
+      struct exec_image *image = list_entry (e, struct exec_image, lru_elem);
+      if (image->ref_cnt == 0)
+        {
+          uncache (image);
+          image_destroy (image);
+          return true;
+        }
+    }
+  return false;
+}
+
+/* Frees IMAGE and its pages. */
+static void image_destroy (struct exec_image *image)
+{
+  int i;
+
+  for (i = 0; i < image->seg_cnt; i++)
+    {
+      size_t j;
+      for (j = 0; j < image->segs[i].page_cnt; j++)
+        palloc_free_page (image->segs[i].pages[j]);
+      free (image->segs[i].pages);
+    }
+  free (image->segs);
+  free (image);
+}
+
+/* Returns a hash value for the image E. */
+static unsigned image_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int (hash_entry (e, struct exec_image, hash_elem)->inumber);
+}
+
+/* Returns true if image A precedes image B. */
+static bool image_less (const struct hash_elem *a, const struct hash_elem *b,
+                        void *aux UNUSED)
+{
+  return (hash_entry (a, struct exec_image, hash_elem)->inumber
+          < hash_entry (b, struct exec_image, hash_elem)->inumber);
+}
@@ -0,0 +1,48 @@
+#ifndef USERPROG_EXECCACHE_H
+#define USERPROG_EXECCACHE_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "devices/block.h"
+
+/* A loadable segment of a cached executable. */
+struct exec_segment
+{
+  uint8_t *upage;   /* User virtual address of first page. */
+  size_t page_cnt;  /* Number of pages. */
+  bool writable;    /* Mapped read/write? */
+  uint8_t **pages;  /* Initial contents, null for all-zero pages. */
+};
+
+/* A validated executable, with its segments read from disk.  Kept
+   in the executable cache, keyed by inode, and referenced by each
+   process running it, which maps its read-only pages directly and
+   copies its writable ones. */
+struct exec_image
+{
+  struct hash_elem hash_elem; /* Element in the cache. */
+  struct list_elem lru_elem;  /* Element in the LRU list. */
+  block_sector_t inumber;     /* Inode of the executable. */
+  int ref_cnt;                /* Number of references. */
+  bool cached;                /* In the cache? */
+  void (*entry) (void);       /* Entry point. */
+  size_t page_cnt;            /* Pages of contents held. */
+  int seg_cnt;                /* Number of segments. */
+  struct exec_segment *segs;  /* Segments. */
+};
+
+void exec_cache_init (void);
+struct exec_image *exec_image_create (block_sector_t, int max_segs);
+struct exec_segment *exec_image_add_segment (struct exec_image *,
+                                             uint8_t *upage, size_t page_cnt,
+                                             bool writable);
+void *exec_cache_get_page (void);
+struct exec_image *exec_cache_lookup (block_sector_t);
+struct exec_image *exec_cache_insert (struct exec_image *);
+void exec_image_release (struct exec_image *);
+void exec_cache_invalidate (block_sector_t);
+
+#endif /* userprog/execcache.h */
@@ -0,0 +1,163 @@
+#include "userprog/fdtable.h"
+#include <debug.h>
+#include <string.h>
+#include "threads/malloc.h"
+
+/* File descriptor tables.
+
+   Most processes open only a handful of files, so the table
+   starts with room for FD_TABLE_INIT descriptors and doubles
+   when it fills, up to FD_TABLE_MAX.  A bitmap of descriptors
+   in use, scanned a word at a time from the MIN_FREE hint,
+   finds the lowest free descriptor for open(), and lets exit()
+   visit only the descriptors that are actually open. */
+
+/* Initial number of descriptors. */
+#define FD_TABLE_INIT 16
+
+/* Bits per bitmap word. */
+#define FD_BITS 32
+
+/* Returns the number of bitmap words needed for SIZE
+   descriptors. */
+static int used_words (int size)
+{
+  return (size + FD_BITS - 1) / FD_BITS;
+}
+
+/* Initializes FDT as an empty table with descriptors 0 and 1
+   reserved.  Returns true if successful, false if memory could
+   not be allocated. */
+bool fd_table_init (struct fd_table *fdt)
+{
+  fdt->size = FD_TABLE_INIT;
+  fdt->files = calloc (fdt->size, sizeof *fdt->files);
+  fdt->used = calloc (used_words (fdt->size), sizeof *fdt->used);
+  if (fdt->files == NULL || fdt->used == NULL)
+    {
+      fd_table_destroy (fdt);
+      return false;
+    }
+  fdt->used[0] = (1u << 0) | (1u << 1);
+  fdt->min_free = 2;
+  return true;
+}
+
+/* Frees FDT's storage.  Files still open in it are not closed. */
+void fd_table_destroy (struct fd_table *fdt)
+{
+  free (fdt->files);
+  free (fdt->used);
+  fdt->files = NULL;
+  fdt->used = NULL;
+  fdt->size = 0;
+}
+
+/* Returns the file open as descriptor FD in FDT, or a null
+   pointer if FD is not open. */
+struct file *fd_table_get (const struct fd_table *fdt, int fd)
+{
+  return fd >= 0 && fd < fdt->size ? fdt->files[fd] : NULL;
+}
+
+/* Sets reserved descriptor FD in FDT to FILE. */
+void fd_table_set (struct fd_table *fdt, int fd, struct file *file)
+{
+  ASSERT (fd >= 0 && fd < 2);
+  fdt->files[fd] = file;
+}
+
+/* Doubles the size of FDT.  Returns true if successful, false if
+   FDT is already at FD_TABLE_MAX or memory is short. */
+static bool grow (struct fd_table *fdt)
+{
+  int new_size = fdt->size * 2;
+  struct file **files;
+  uint32_t *used;
+
+  if (new_size > FD_TABLE_MAX)
+    return false;
+  files = realloc (fdt->files, new_size * sizeof *files);
+  if (files == NULL)
+    return false;
+  fdt->files = files;
+  used = realloc (fdt->used, used_words (new_size) * sizeof *used);
+  if (used == NULL)
+    return false;
+  fdt->used = used;
+
+  memset (files + fdt->size, 0, (new_size - fdt->size) * sizeof *files);
+  memset (used + used_words (fdt->size), 0,
+          (used_words (new_size) - used_words (fdt->size)) * sizeof *used);
+  fdt->size = new_size;
+  return true;
+}
+
+/* Opens FILE as the lowest free descriptor in FDT, growing the
+   table if necessary, and returns the descriptor.  Returns -1 if
+   the process already has FD_TABLE_MAX descriptors. */
+int fd_table_insert (struct fd_table *fdt, struct file *file)
+{
+  int word;
+  int fd;
+
+  ASSERT (file != NULL);
+
+  for (word = fdt->min_free / FD_BITS; word < used_words (fdt->size); word++)
+    if (fdt->used[word] != UINT32_MAX)
+      break;
+  fd = word * FD_BITS;
+  if (word < used_words (fdt->size))
+    fd += __builtin_ctz (~fdt->used[word]);
+  if (fd >= fdt->size && !grow (fdt))
+    return -1;
+
+  fdt->files[fd] = file;
+  fdt->used[fd / FD_BITS] |= 1u << (fd % FD_BITS);
+  fdt->min_free = fd + 1;
+  return fd;
+}
+
+/* Closes descriptor FD in FDT and returns the file that was open
+   on it, or a null pointer if FD was not open.  Reserved
+   descriptors stay reserved. */
+struct file *fd_table_remove (struct fd_table *fdt, int fd)
+{
+  struct file *file = fd_table_get (fdt, fd);
+
+  if (file == NULL)
+    return NULL;
+  fdt->files[fd] = NULL;
+  if (fd >= 2)
+    {
+      fdt->used[fd / FD_BITS] &= ~(1u << (fd % FD_BITS));
+      if (fd < fdt->min_free)
+        fdt->min_free = fd;
+    }
+  return file;
+}
+
+/* Returns the lowest descriptor at least FD that is open in FDT
+   and not reserved, or -1 if there is none.  For iterating over
+   open files:
+
+      for (fd = fd_table_next (fdt, 0); fd >= 0;
+           fd = fd_table_next (fdt, fd + 1))
+        ...
+*/
+int fd_table_next (const struct fd_table *fdt, int fd)
+{
+  int word;
+
+  if (fd < 2)
+    fd = 2;
+  for (word = fd / FD_BITS; word < used_words (fdt->size); word++)
+    {
+      uint32_t bits = fdt->used[word];
+      if (word == fd / FD_BITS)
+        bits &= UINT32_MAX << (fd % FD_BITS);
+      if (bits != 0)
+        return word * FD_BITS + __builtin_ctz (bits);
+    }
+  return -1;
+}
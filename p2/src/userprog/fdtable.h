@@ -0,0 +1,30 @@
+#ifndef USERPROG_FDTABLE_H
+#define USERPROG_FDTABLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Maximum number of file descriptors per process. */
+#define FD_TABLE_MAX 1024
+
+/* A process's file descriptor table.  Descriptor 0 holds the
+   process's executable, kept open to deny writes to it, and
+   descriptor 1 is the console; both are always reserved, so
+   open() hands out descriptors from 2 up. */
+struct fd_table
+{
+  struct file **files; /* Open files, indexed by descriptor. */
+  uint32_t *used;      /* Bitmap of descriptors in use. */
+  int size;            /* Number of entries in FILES. */
+  int min_free;        /* No descriptor below this is free. */
+};
+
+bool fd_table_init (struct fd_table *);
+void fd_table_destroy (struct fd_table *);
+struct file *fd_table_get (const struct fd_table *, int fd);
+void fd_table_set (struct fd_table *, int fd, struct file *);
+int fd_table_insert (struct fd_table *, struct file *);
+struct file *fd_table_remove (struct fd_table *, int fd);
+int fd_table_next (const struct fd_table *, int fd);
+
+#endif /* userprog/fdtable.h */
@@ -6,6 +6,10 @@
 #include "threads/pte.h"
 #include "threads/palloc.h"
 
+/* Marks a page that pagedir_destroy() must not free, because it
+   belongs to someone else, e.g. the executable cache. */
+#define PTE_SHARED 0x200
+
 static uint32_t *active_pd (void);
 static void invalidate_pagedir (uint32_t *);
 
@@ -22,7 +26,7 @@ uint32_t *pagedir_create (void)
 }
 
 /* Destroys page directory PD, freeing all the pages it
-   references. */
+   references, except those mapped with pagedir_share_page(). */
 void pagedir_destroy (uint32_t *pd)
 {
   uint32_t *pde;
@@ -38,7 +42,7 @@ void pagedir_destroy (uint32_t *pd)
         uint32_t *pte;
 
         for (pte = pt; pte < pt + PGSIZE / sizeof *pte; pte++)
-          if (*pte & PTE_P)
+          if ((*pte & (PTE_P | PTE_SHARED)) == PTE_P)
             palloc_free_page (pte_get_page (*pte));
         palloc_free_page (pt);
       }
@@ -114,6 +118,31 @@ bool pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool writable)
     return false;
 }
 
+/* Like pagedir_set_page(), but maps KPAGE read-only and leaves it
+   to its owner to free, so that KPAGE can be shared among
+   several page directories. */
+bool pagedir_share_page (uint32_t *pd, void *upage, void *kpage)
+{
+  uint32_t *pte;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (pg_ofs (kpage) == 0);
+  ASSERT (is_user_vaddr (upage));
+  ASSERT (vtop (kpage) >> PTSHIFT < init_ram_pages);
+  ASSERT (pd != init_page_dir);
+
+  pte = lookup_page (pd, upage, true);
+
+  if (pte != NULL)
+    {
+      ASSERT ((*pte & PTE_P) == 0);
+      *pte = pte_create_user (kpage, false) | PTE_SHARED;
+      return true;
+    }
+  else
+    return false;
+}
+
 /* Looks up the physical address that corresponds to user virtual
    address UADDR in PD.  Returns the kernel virtual address
    corresponding to that physical address, or a null pointer if
@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "userprog/execcache.h"
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
 #include "userprog/tss.h"
@@ -12,10 +13,12 @@
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/inode.h"
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
 #include "threads/palloc.h"
+#include "threads/synch.h"
 #include "threads/malloc.h"
 #include "lib/string.h"
 #include "threads/thread.h"
@@ -23,8 +26,6 @@
 #include "vm/page.h"
 #include "vm/frame.h"
 
-#define ALIGN(ADDR) ((void *) ((uintptr_t) ADDR - (uintptr_t) ADDR % 4))
-
 static thread_func start_process NO_RETURN;
 
 /* Starts a new thread running a user program loaded from
@@ -33,34 +34,99 @@ static thread_func start_process NO_RETURN;
    thread id, or TID_ERROR if the thread cannot be created. */
 tid_t process_execute (const char *file_name)
 {
-  char *fn_copy;
-  tid_t tid;
+  struct exec_args *args;
+  char *cmd_line;
 
-  /* Make a copy of FILE_NAME.
-     Otherwise there's a race between the caller and load(). */
-  fn_copy = palloc_get_page (0);
-  if (fn_copy == NULL)
+  /* Make a copy of FILE_NAME, since splitting it modifies it. */
+  cmd_line = palloc_get_page (0);
+  if (cmd_line == NULL)
     return TID_ERROR;
-  strlcpy (fn_copy, file_name, PGSIZE);
+  strlcpy (cmd_line, file_name, PGSIZE);
+  args = exec_args_parse (cmd_line);
+  palloc_free_page (cmd_line);
 
-  // Get executable name for thread create
-  char *save_ptr;
-  const char delimiter[7] = " \t\r\n\f\v";
-  int len = strlen (file_name);
-  char args_copy[len + 1];
-  strlcpy (args_copy, file_name, len + 1);
-  char *exec_name = strtok_r ((char *) args_copy, delimiter, &save_ptr);
+  return args != NULL ? process_execv (args) : TID_ERROR;
+}
+
+/* Starts a new thread running the user program and arguments in
+   ARGS, which must have been obtained from exec_args_create() and
+   is freed.  Otherwise like process_execute(). */
+tid_t process_execv (struct exec_args *args)
+{
+  tid_t tid;
 
-  /* Create a new thread to execute FILE_NAME. */
-  tid = thread_create (exec_name, PRI_DEFAULT, start_process, fn_copy);
+  /* Create a new thread to execute ARGS->PATH. */
+  tid = thread_create (args->path, PRI_DEFAULT, start_process, args);
   if (tid == TID_ERROR)
-    palloc_free_page (fn_copy);
+    palloc_free_page (args);
   return tid;
 }
 
+/* Returns a new set of exec arguments for running PATH, with no
+   arguments yet, or a null pointer if memory is short or PATH
+   does not fit in a page.  Free with palloc_free_page(). */
+struct exec_args *exec_args_create (const char *path)
+{
+  struct exec_args *args;
+  size_t path_size = strlen (path) + 1;
+
+  if (path_size > PGSIZE - sizeof *args)
+    return NULL;
+  args = palloc_get_page (0);
+  if (args == NULL)
+    return NULL;
+  memcpy (args->path, path, path_size);
+  args->argc = 0;
+  args->argv = args->path + path_size;
+  args->argv_size = 0;
+  return args;
+}
+
+/* Splits CMD_LINE, which is modified, into words separated by
+   white space, and returns a new set of exec arguments with the
+   words as arguments and the first as the program as well.
+   Returns a null pointer if CMD_LINE is empty, too long, or
+   memory is short. */
+struct exec_args *exec_args_parse (char *cmd_line)
+{
+  const char delimiter[7] = " \t\r\n\f\v";
+  struct exec_args *args;
+  char *save_ptr;
+  char *token;
+
+  token = strtok_r (cmd_line, delimiter, &save_ptr);
+  if (token == NULL)
+    return NULL;
+  args = exec_args_create (token);
+  for (; args != NULL && token != NULL;
+       token = strtok_r (NULL, delimiter, &save_ptr))
+    if (!exec_args_push (args, token))
+      {
+        palloc_free_page (args);
+        args = NULL;
+      }
+  return args;
+}
+
+/* Appends ARG to ARGS.  Returns true if successful, false if ARGS
+   is full. */
+bool exec_args_push (struct exec_args *args, const char *arg)
+{
+  char *end = (char *) args + PGSIZE;
+  char *dst = args->argv + args->argv_size;
+  size_t size = strlen (arg) + 1;
+
+  if (size > (size_t) (end - dst))
+    return false;
+  memcpy (dst, arg, size);
+  args->argc++;
+  args->argv_size += size;
+  return true;
+}
+
 /* A thread function that loads a user process and starts it
    running. */
-static void start_process (void *filename)
+static void start_process (void *args)
 {
   struct intr_frame if_;
   bool success;
@@ -70,16 +136,13 @@ static void start_process (void *filename)
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
-  success = load (filename, &if_.eip, &if_.esp);
-
-  if (!is_kernel_vaddr (filename))
-    palloc_free_page (filename);
+  success = load (args, &if_.eip, &if_.esp);
+  palloc_free_page (args);
 
   thread_current ()->parent->success = success;
   sema_up (&thread_current ()->parent->child_created);
 
   /* If load failed, quit. */
-  palloc_free_page (filename);
   if (!success)
     {
       exit (-1);
@@ -95,41 +158,81 @@ static void start_process (void *filename)
   NOT_REACHED ();
 }
 
+/* Process table, mapping tids to struct process.  Buckets are
+   chosen by tid, which are handed out sequentially, so chains
+   stay short. */
+#define PROCESS_BUCKET_CNT 256
+static struct list process_buckets[PROCESS_BUCKET_CNT];
+static struct lock process_lock;
+
+static struct list *process_bucket (tid_t);
+static struct process *process_lookup (tid_t);
+
+/* Initializes the process table. */
+void process_table_init (void)
+{
+  size_t i;
+
+  for (i = 0; i < PROCESS_BUCKET_CNT; i++)
+    list_init (&process_buckets[i]);
+  lock_init (&process_lock);
+}
+
+/* Creates a process table entry for new thread T, whose tid must
+   already be set, as a child of the running thread.  Returns
+   true if successful, false if memory is not available. */
+bool process_register (struct thread *t)
+{
+  struct thread *cur = thread_current ();
+  struct process *p = malloc (sizeof *p);
+  if (p == NULL)
+    return false;
+
+  p->pid = t->tid;
+  p->parent = cur->tid;
+  p->exited = false;
+  p->exit_status = -1;
+  sema_init (&p->exited_sema, 0);
+  t->process = p;
+
+  lock_acquire (&process_lock);
+  list_push_back (process_bucket (p->pid), &p->bucket_elem);
+  list_push_back (&cur->children, &p->elem);
+  lock_release (&process_lock);
+  return true;
+}
+
 /* Waits for thread TID to die and returns its exit status.  If
    it was terminated by the kernel (i.e. killed due to an
    exception), returns -1.  If TID is invalid or if it was not a
    child of the calling process, or if process_wait() has already
    been successfully called for the given TID, returns -1
-   immediately, without waiting.
-
-   This function will be implemented in problem 2-2.  For now, it
-   does nothing. */
-int process_wait (tid_t child_tid UNUSED)
+   immediately, without waiting. */
+int process_wait (tid_t child_tid)
 {
-  struct thread *parent = thread_current ();
-  struct list *children = &parent->children;
+  struct process *p;
+  int status;
 
-  if (list_empty (children))
+  lock_acquire (&process_lock);
+  p = process_lookup (child_tid);
+  if (p == NULL || p->parent != thread_current ()->tid)
     {
+      lock_release (&process_lock);
       return -1;
     }
+  lock_release (&process_lock);
 
-  // Find child if in children list and wait on its exit returning status
-  struct list_elem *curr;
-  for (curr = list_front (children); curr != list_end (children);
-       curr = list_next (curr))
-    {
-      struct child *curr_item = list_entry (curr, struct child, elem);
-      if (curr_item->pid == child_tid)
-        {
-          sema_down (&curr_item->exited);
-          list_remove (curr);
-          int status = curr_item->exit_status;
-          free (curr_item);
-          return status;
-        }
-    }
-  return -1;
+  /* Only we can free P, so it stays valid while we wait. */
+  sema_down (&p->exited_sema);
+
+  lock_acquire (&process_lock);
+  status = p->exit_status;
+  list_remove (&p->bucket_elem);
+  list_remove (&p->elem);
+  lock_release (&process_lock);
+  free (p);
+
+  return status;
 }
 
 /* Free the current process's resources. */
@@ -137,6 +240,36 @@ void process_exit (void)
 {
   struct thread *cur = thread_current ();
   uint32_t *pd;
+  struct process *p;
+
+  /* Update the process table.  Our children become orphans, and
+     those that have already exited can never be waited for, so
+     free their entries.  Then report our own exit, freeing our
+     entry if our parent is gone. */
+  lock_acquire (&process_lock);
+  while (!list_empty (&cur->children))
+    {
+      p = list_entry (list_pop_front (&cur->children), struct process, elem);
+      p->parent = TID_ERROR;
+      if (p->exited)
+        {
+          list_remove (&p->bucket_elem);
+          free (p);
+        }
+    }
+  p = cur->process;
+  if (p != NULL)
+    {
+      p->exited = true;
+      if (p->parent == TID_ERROR)
+        {
+          list_remove (&p->bucket_elem);
+          free (p);
+        }
+      else
+        sema_up (&p->exited_sema);
+    }
+  lock_release (&process_lock);
 
   /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
@@ -154,6 +287,35 @@ void process_exit (void)
       pagedir_activate (NULL);
       pagedir_destroy (pd);
     }
+
+  /* Release our executable's image, whose pages we may have been
+     sharing. */
+  exec_image_release (cur->exec_image);
+  cur->exec_image = NULL;
+}
+
+/* Returns the process table bucket for PID. */
+static struct list *process_bucket (tid_t pid)
+{
+  return &process_buckets[(unsigned) pid % PROCESS_BUCKET_CNT];
+}
+
+/* Returns the process table entry for PID, or a null pointer if
+   there is none.  process_lock must be held. */
+static struct process *process_lookup (tid_t pid)
+{
+  struct list *bucket = process_bucket (pid);
+  struct list_elem *e;
+
+  ASSERT (lock_held_by_current_thread (&process_lock));
+
+  for (e = list_begin (bucket); e != list_end (bucket); e = list_next (e))
+    {
+      struct process *p = list_entry (e, struct process, bucket_elem);
+      if (p->pid == pid)
+        return p;
+    }
+  return NULL;
 }
 
 /* Sets up the CPU for running user code in the current
@@ -186,31 +348,26 @@ void process_activate (void)
 #define PF_W 2 /* Writable. */
 #define PF_R 4 /* Readable. */
 
-static bool setup_stack (void **esp, const char *filename);
+static bool setup_stack (void **esp, const struct exec_args *);
+static struct exec_image *read_image (struct file *);
+static bool map_image (const struct exec_image *);
 static bool validate_segment (const struct Elf32_Phdr *, struct file *);
-static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
-                          uint32_t read_bytes, uint32_t zero_bytes,
-                          bool writable);
-
-/* Loads an ELF executable from FILE_NAME into the current thread.
-   Stores the executable's entry point into *EIP
-   and its initial stack pointer into *ESP.
-   Returns true if successful, false otherwise. */
-bool load (const char *args, void (**eip) (void), void **esp)
+static bool read_segment (struct exec_image *, struct file *file, off_t ofs,
+                          uint8_t *upage, uint32_t read_bytes,
+                          uint32_t zero_bytes, bool writable);
+
+/* Loads an ELF executable from ARGS->PATH into the current
+   thread, with ARGS->ARGV as its arguments.  Stores the
+   executable's entry point into *EIP and its initial stack
+   pointer into *ESP.  Returns true if successful, false
+   otherwise. */
+bool load (const struct exec_args *args, void (**eip) (void), void **esp)
 {
   struct thread *t = thread_current ();
-  struct Elf32_Ehdr ehdr;
+  const char *filename = args->path;
+  struct exec_image *image;
   struct file *file = NULL;
-  off_t file_ofs;
   bool success = false;
-  int argc;
-
-  char *save_ptr;
-  const char delimiter[7] = " \t\r\n\f\v";
-  int len = strlen (args);
-  char args_copy[len + 1];
-  strlcpy (args_copy, args, len + 1);
-  char *filename = strtok_r ((char *) args_copy, delimiter, &save_ptr);
 
   /* Allocate and activate page directory. */
   t->pagedir = pagedir_create ();
@@ -225,33 +382,88 @@ bool load (const char *args, void (**eip) (void), void **esp)
       printf ("load: %s: open failed\n", filename);
       goto done;
     }
+  file_deny_write (file);
+
+  /* Use the cached image of the executable, or read and cache
+     one. */
+  image = exec_cache_lookup (inode_get_inumber (file_get_inode (file)));
+  if (image == NULL)
+    {
+      image = read_image (file);
+      if (image == NULL)
+        {
+          printf ("load: %s: error loading executable\n", filename);
+          goto done;
+        }
+      image = exec_cache_insert (image);
+    }
+  t->exec_image = image;
+
+  /* Map its segments. */
+  if (!map_image (image))
+    goto done;
+
+  /* Set up stack. */
+  if (!setup_stack (esp, args))
+    goto done;
+
+  /* Start address. */
+  *eip = image->entry;
+
+  /* Keep the executable open as descriptor 0, denying writes to
+     it, until the process exits. */
+  fd_table_set (&t->fds, 0, file);
+  file = NULL;
+  success = true;
+
+done:
+  /* We arrive here whether the load is successful or not. */
+  file_close (file);
+  return success;
+}
+
+/* load() helpers. */
+
+static bool install_page (void *upage, void *kpage, bool writable);
+static bool share_page (void *upage, void *kpage);
+
+/* Reads and verifies the ELF executable FILE and returns a new,
+   uncached image of it, or a null pointer if it is not a valid
+   executable or memory is short. */
+static struct exec_image *read_image (struct file *file)
+{
+  struct Elf32_Ehdr ehdr;
+  struct exec_image *image;
+  off_t file_ofs;
+  int i;
 
   /* Read and verify executable header. */
   if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr ||
       memcmp (ehdr.e_ident, "\177ELF\1\1\1", 7) || ehdr.e_type != 2 ||
       ehdr.e_machine != 3 || ehdr.e_version != 1 ||
       ehdr.e_phentsize != sizeof (struct Elf32_Phdr) || ehdr.e_phnum > 1024)
-    {
-      printf ("load: %s: error loading executable\n", filename);
-      goto done;
-    }
+    return NULL;
+
+  image = exec_image_create (inode_get_inumber (file_get_inode (file)),
+                             ehdr.e_phnum);
+  if (image == NULL)
+    return NULL;
+  image->entry = (void (*) (void)) ehdr.e_entry;
 
   /* Read program headers. */
   file_ofs = ehdr.e_phoff;
-  for (argc = 0; argc < ehdr.e_phnum; argc++)
+  for (i = 0; i < ehdr.e_phnum; i++)
     {
       struct Elf32_Phdr phdr;
 
       if (file_ofs < 0 || file_ofs > file_length (file))
-        goto done;
+        goto fail;
       file_seek (file, file_ofs);
 
       if (file_read (file, &phdr, sizeof phdr) != sizeof phdr)
-        goto done;
+        goto fail;
       file_ofs += sizeof phdr;
-      
-      // [placeholder] - it is turtles all the way down
-      
+
       switch (phdr.p_type)
         {
           case PT_NULL:
@@ -264,7 +476,7 @@ bool load (const char *args, void (**eip) (void), void **esp)
           case PT_DYNAMIC:
           case PT_INTERP:
           case PT_SHLIB:
-            goto done;
+            goto fail;
           case PT_LOAD:
             if (validate_segment (&phdr, file))
               {
@@ -289,34 +501,64 @@ bool load (const char *args, void (**eip) (void), void **esp)
                     read_bytes = 0;
                     zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
                   }
-                if (!load_segment (file, file_page, (void *) mem_page,
+                if (!read_segment (image, file, file_page, (void *) mem_page,
                                    read_bytes, zero_bytes, writable))
-                  goto done;
+                  goto fail;
               }
             else
-              goto done;
+              goto fail;
             break;
         }
     }
+  return image;
 
-  /* Set up stack. */
-  if (!setup_stack (esp, args))
-    goto done;
+fail:
+  exec_image_release (image);
+  return NULL;
+}
 
-  /* Start address. */
-  *eip = (void (*) (void)) ehdr.e_entry;
+/* Maps IMAGE's segments into the current process.  Read-only
+   pages are shared with IMAGE; writable ones are copied.  Returns
+   true if successful, false if memory is short or segments
+   overlap. */
+static bool map_image (const struct exec_image *image)
+{
+  int i;
 
-  success = true;
+  for (i = 0; i < image->seg_cnt; i++)
+    {
+      const struct exec_segment *seg = &image->segs[i];
+      size_t j;
 
-done:
-  /* We arrive here whether the load is successful or not. */
-  file_close (file);
-  return success;
-}
+      for (j = 0; j < seg->page_cnt; j++)
+        {
+          uint8_t *upage = seg->upage + j * PGSIZE;
+          uint8_t *contents = seg->pages[j];
+          uint8_t *kpage;
 
-/* load() helpers. */
+          if (contents != NULL && !seg->writable)
+            {
+              if (!share_page (upage, contents))
+                return false;
+              continue;
+            }
 
-static bool install_page (void *upage, void *kpage, bool writable);
+          kpage = exec_cache_get_page ();
+          if (kpage == NULL)
+            return false;
+          if (contents != NULL)
+            memcpy (kpage, contents, PGSIZE);
+          else
+            memset (kpage, 0, PGSIZE);
+          if (!install_page (upage, kpage, seg->writable))
+            {
+              palloc_free_page (kpage);
+              return false;
+            }
+        }
+    }
+  return true;
+}
 
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -362,30 +604,41 @@ static bool validate_segment (const struct Elf32_Phdr *phdr, struct file *file)
   return true;
 }
 
-/* Loads a segment starting at offset OFS in FILE at address
-   UPAGE.  In total, READ_BYTES + ZERO_BYTES bytes of virtual
-   memory are initialized, as follows:
+/* Adds a segment to IMAGE at address UPAGE, whose contents start
+   at offset OFS in FILE.  In total, READ_BYTES + ZERO_BYTES bytes
+   of virtual memory are described, as follows:
 
         - READ_BYTES bytes at UPAGE must be read from FILE
           starting at offset OFS.
 
         - ZERO_BYTES bytes at UPAGE + READ_BYTES must be zeroed.
 
-   The pages initialized by this function must be writable by the
-   user process if WRITABLE is true, read-only otherwise.
+   Pages with bytes from FILE are read into the image now, with
+   their tails zeroed.  Pages that are entirely zero are left null
+   and allocated when the image is mapped.  The pages must be
+   writable by the user process if WRITABLE is true, read-only
+   otherwise.
 
    Return true if successful, false if a memory allocation error
    or disk read error occurs. */
-static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
-                          uint32_t read_bytes, uint32_t zero_bytes,
-                          bool writable)
+static bool read_segment (struct exec_image *image, struct file *file,
+                          off_t ofs, uint8_t *upage, uint32_t read_bytes,
+                          uint32_t zero_bytes, bool writable)
 {
+  struct exec_segment *seg;
+  size_t i;
+
   ASSERT ((read_bytes + zero_bytes) % PGSIZE == 0);
   ASSERT (pg_ofs (upage) == 0);
   ASSERT (ofs % PGSIZE == 0);
 
+  seg = exec_image_add_segment (image, upage,
+                                (read_bytes + zero_bytes) / PGSIZE, writable);
+  if (seg == NULL)
+    return false;
+
   file_seek (file, ofs);
-  while (read_bytes > 0 || zero_bytes > 0)
+  for (i = 0; read_bytes > 0; i++)
     {
       /* Calculate how to fill this page.
          We will read PAGE_READ_BYTES bytes from FILE
@@ -394,138 +647,86 @@ static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
       size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
       /* Get a page of memory. */
-      uint8_t *kpage = palloc_get_page (PAL_USER);
+      uint8_t *kpage = exec_cache_get_page ();
       if (kpage == NULL)
         return false;
+      seg->pages[i] = kpage;
 
       /* Load this page. */
       if (file_read (file, kpage, page_read_bytes) != (int) page_read_bytes)
-        {
-          palloc_free_page (kpage);
-          return false;
-        }
+        return false;
       memset (kpage + page_read_bytes, 0, page_zero_bytes);
 
-      /* Add the page to the process's address space. */
-      if (!install_page (upage, kpage, writable))
-        {
-          palloc_free_page (kpage);
-          return false;
-        }
-
       /* Advance. */
       read_bytes -= page_read_bytes;
-      zero_bytes -= page_zero_bytes;
-      upage += PGSIZE;
     }
   return true;
 }
 
-static bool decrement_stack (char **char_esp, void *stackpg, char **tokens,
-                             int d)
-{
-  *char_esp -= d;
-  bool valid_dec =
-      ((uintptr_t) *char_esp >= (uintptr_t) PHYS_BASE - (uintptr_t) PGSIZE);
-  if (!valid_dec)
-    {
-      palloc_free_page (tokens);
-      palloc_free_page (stackpg);
-    }
-  return valid_dec;
-}
-
 /* Create a minimal stack by mapping a zeroed page at the top of
-   user virtual memory. */
-static bool setup_stack (void **esp, const char *filename)
+   user virtual memory, and lay out ARGS on it for main():
+
+        argv strings, in order, ending at PHYS_BASE
+        padding to a multiple of 4 bytes
+        argv[0] ... argv[argc - 1], then a null pointer
+        argv
+        argc
+        return address (null)
+
+   The strings are copied in one block, since they are already
+   packed back to back in ARGS.  The page comes from
+   exec_cache_get_page(), so that unused cached executables give
+   way to it when the user pool is short.  Fails if ARGS does not
+   fit in the page. */
+static bool setup_stack (void **esp, const struct exec_args *args)
 {
+  uint8_t *upage = ((uint8_t *) PHYS_BASE) - PGSIZE;
   uint8_t *kpage;
-  bool success = false;
-  char *file_name = (char *) filename;
+  size_t strings_size = ROUND_UP (args->argv_size, sizeof (char *));
+  size_t vector_size = (args->argc + 1) * sizeof (char *);
+  size_t frame_size = 3 * sizeof (uint32_t);
+  uint32_t *frame;
+  char **argv;
+  char *strings;
+  char *arg;
+  int i;
+
+  if (strings_size + vector_size + frame_size > PGSIZE)
+    return false;
 
-  char **tokens = palloc_get_page (0);
-  if (tokens == NULL)
+  kpage = exec_cache_get_page ();
+  if (kpage == NULL)
     return false;
-  char *save_ptr;
-  const char delimiter[7] = " \t\r\n\f\v";
-  tokens[0] = strtok_r (file_name, delimiter, &save_ptr);
-  int argc = 0;
-  while (tokens[argc])
+  memset (kpage, 0, PGSIZE);
+  if (!install_page (upage, kpage, true))
     {
-      argc++;
-      if (argc > 128)
-        {
-          return false;
-        }
-      tokens[argc] = strtok_r (NULL, delimiter, &save_ptr);
+      palloc_free_page (kpage);
+      return false;
     }
 
-  kpage = frame_alloc_and_lock (PAL_USER | PAL_ZERO);
-  if (kpage != NULL)
+  /* Everything is written through KPAGE; the user addresses it
+     stores are the corresponding ones in UPAGE. */
+  strings = (char *) kpage + PGSIZE - args->argv_size;
+  memcpy (strings, args->argv, args->argv_size);
+
+  argv = (char **) (kpage + PGSIZE - strings_size - vector_size);
+  arg = (char *) PHYS_BASE - args->argv_size;
+  for (i = 0; i < args->argc; i++)
     {
-      success = install_page (((uint8_t *) PHYS_BASE) - PGSIZE, kpage, true);
-      if (success)
-        {
-          *esp = PHYS_BASE;
-          char *char_esp = (char *) *esp;
-          int i = argc - 1;
-          while (i >= 0)
-            {
-              int len = strlen (tokens[i]) + 1;
-              if (!decrement_stack (&char_esp, kpage, tokens, len))
-                {
-                  return false;
-                }
-              memcpy (char_esp, tokens[i], len);
-              i--;
-            }
+      size_t size = strlen (strings) + 1;
+      argv[i] = arg;
+      arg += size;
+      strings += size;
+    }
+  argv[args->argc] = NULL;
 
-          char_esp = ALIGN (char_esp); // align down to nearest multiple of 4
+  frame = (uint32_t *) argv - 3;
+  frame[0] = 0;
+  frame[1] = args->argc;
+  frame[2] = (uint32_t) (upage + ((uint8_t *) argv - kpage));
 
-          if (!decrement_stack (&char_esp, kpage, tokens, 4))
-            {
-              return false;
-            }
-          int *arg_end = (int *) char_esp;
-          *arg_end = 0;
-
-          i = argc - 1;
-          char *top = *esp;
-          while (i >= 0)
-            {
-              if (!decrement_stack (&char_esp, kpage, tokens, 4))
-                {
-                  return false;
-                }
-              top -= strlen (tokens[i]) + 1;
-              memcpy (char_esp, &top, 4);
-              i--;
-            }
-          char *arg_start = char_esp;
-          if (!decrement_stack (&char_esp, kpage, tokens, 4))
-            {
-              return false;
-            }
-          memcpy (char_esp, &arg_start, 4);
-          if (!decrement_stack (&char_esp, kpage, tokens, 4))
-            {
-              return false;
-            }
-          memcpy (char_esp, &argc, 4);
-          if (!decrement_stack (&char_esp, kpage, tokens, 4))
-            {
-              return false;
-            }
-          *esp = char_esp;
-          palloc_free_page (tokens);
-        }
-      else
-        {
-          palloc_free_page (tokens);
-          frame_unlock(kpage);
-        }
-    }
-  return success;
+  *esp = upage + ((uint8_t *) frame - kpage);
+  return true;
 }
 
 /* Adds a mapping from user virtual address UPAGE to kernel
@@ -546,3 +747,13 @@ static bool install_page (void *upage, void *kpage, bool writable)
   return (pagedir_get_page (t->pagedir, upage) == NULL &&
           pagedir_set_page (t->pagedir, upage, kpage, writable));
 }
+
+/* Like install_page(), but maps KPAGE read-only and leaves it to
+   its owner, the executable cache, to free. */
+static bool share_page (void *upage, void *kpage)
+{
+  struct thread *t = thread_current ();
+
+  return (pagedir_get_page (t->pagedir, upage) == NULL &&
+          pagedir_share_page (t->pagedir, upage, kpage));
+}
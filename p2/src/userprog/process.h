@@ -1,17 +1,36 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
 
+#include <stddef.h>
 #include "threads/thread.h"
 #include "lib/kernel/list.h"
 #include "threads/synch.h"
 
-struct child
+/* An entry in the process table, which records a thread's exit
+   status for its parent.  Created by thread_create() and freed
+   once both the thread has exited and its parent has waited for
+   it or exited itself. */
+struct process
 {
-   struct thread* child_thread;
-   struct list_elem elem;
-   struct semaphore exited;
-   int pid;
-   int exit_status;
+  tid_t pid;                    /* Thread's tid, the table key. */
+  tid_t parent;                 /* Parent's tid, TID_ERROR if orphan. */
+  struct list_elem elem;        /* Element in parent's children list. */
+  struct list_elem bucket_elem; /* Element in a process table bucket. */
+  bool exited;                  /* Has the thread exited? */
+  int exit_status;              /* Exit status, -1 if killed. */
+  struct semaphore exited_sema; /* Upped when the thread exits. */
+};
+
+/* The program and arguments for a new process, built by its
+   parent and consumed by load(), which copies the arguments onto
+   the new process's stack as they are.  Occupies one page, which
+   PATH and ARGV share. */
+struct exec_args
+{
+  int argc;         /* Number of arguments. */
+  char *argv;       /* ARGC null-terminated strings, back to back. */
+  size_t argv_size; /* Bytes in ARGV, including null terminators. */
+  char path[];      /* Executable's file name, followed by ARGV. */
 };
 
 /* We load ELF binaries.  The following definitions are taken
@@ -62,8 +81,14 @@ struct Elf32_Phdr
   Elf32_Word p_align;
 };
 
-bool load (const char *cmdline, void (**eip) (void), void **esp);
+void process_table_init (void);
+bool process_register (struct thread *);
+bool load (const struct exec_args *, void (**eip) (void), void **esp);
+struct exec_args *exec_args_create (const char *path);
+bool exec_args_push (struct exec_args *, const char *arg);
+struct exec_args *exec_args_parse (char *cmd_line);
 tid_t process_execute (const char *file_name);
+tid_t process_execv (struct exec_args *);
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (void);
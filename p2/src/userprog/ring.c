@@ -0,0 +1,159 @@
+#include "userprog/ring.h"
+#include <debug.h>
+#include "threads/thread.h"
+#include "userprog/syscall.h"
+#include "userprog/uaccess.h"
+
+/* Batched system calls.
+
+   The rings live in user memory, and the kernel reads and writes
+   them with copy_from_user() and copy_to_user() while the owning
+   process is in ring_enter(), so nothing is pinned or mapped
+   into the kernel.  Entries move in batches of up to RING_BATCH,
+   one copy for the submissions and one for the completions, and
+   each operation goes to the same function as the corresponding
+   system call. */
+
+/* Maximum number of entries copied at once. */
+#define RING_BATCH 16
+
+/* Registers SQ and CQ, each with room for ENTRIES entries, as the
+   current process's submission and completion rings, replacing
+   any registered before.  ENTRIES must be a power of 2 no greater
+   than RING_MAX_ENTRIES, or 0 to unregister the rings.  Returns
+   true if successful, false if ENTRIES is bad or the rings are
+   not in writable user memory. */
+bool ring_setup (struct ring_sq *sq, struct ring_cq *cq, unsigned entries)
+{
+  struct thread *t = thread_current ();
+
+  if (entries != 0)
+    {
+      if (entries > RING_MAX_ENTRIES || (entries & (entries - 1)) != 0)
+        return false;
+      if (!check_user_range (sq, sizeof *sq + entries * sizeof *sq->entries,
+                             true)
+          || !check_user_range (cq,
+                                sizeof *cq + entries * sizeof *cq->entries,
+                                true))
+        return false;
+    }
+  t->ring_sq = entries != 0 ? sq : NULL;
+  t->ring_cq = entries != 0 ? cq : NULL;
+  t->ring_entries = entries;
+  return true;
+}
+
+/* Carries out operation E and returns its result.  Sets *FAILED
+   to true if it failed, false otherwise. */
+static int32_t execute (const struct ring_sqe *e, bool *failed)
+{
+  int32_t result;
+
+  switch (e->op)
+    {
+      case RING_NOP:
+        result = 0;
+        break;
+      case RING_READ:
+        result = read (e->fd, e->buf, e->len);
+        *failed = result != (int32_t) e->len;
+        return result;
+      case RING_WRITE:
+        result = write (e->fd, e->buf, e->len);
+        *failed = result != (int32_t) e->len;
+        return result;
+      case RING_OPEN:
+        result = open (e->buf);
+        break;
+      case RING_CLOSE:
+        close (e->fd);
+        result = 0;
+        break;
+      case RING_SEEK:
+        seek (e->fd, e->len);
+        result = 0;
+        break;
+      default:
+        result = -1;
+        break;
+    }
+  *failed = result < 0;
+  return result;
+}
+
+/* Carries out up to TO_SUBMIT operations queued in the current
+   process's submission ring, stopping early if the ring empties
+   or the completion ring fills, and posts their results to the
+   completion ring.  Returns the number carried out, or -1 if no
+   rings are registered or their indexes are inconsistent.  Kills
+   the process if the rings are no longer mapped. */
+int ring_enter (unsigned to_submit)
+{
+  struct thread *t = thread_current ();
+  struct ring_sq *sq = t->ring_sq;
+  struct ring_cq *cq = t->ring_cq;
+  uint32_t entries = t->ring_entries;
+  uint32_t mask = entries - 1;
+  uint32_t sq_idx[2], cq_idx[2];   /* Head and tail. */
+  uint32_t cnt, done;
+  bool cancel = false;
+
+  if (sq == NULL)
+    return -1;
+  if (!copy_from_user (sq_idx, sq, sizeof sq_idx)
+      || !copy_from_user (cq_idx, cq, sizeof cq_idx))
+    exit (-1);
+  if (sq_idx[1] - sq_idx[0] > entries || cq_idx[1] - cq_idx[0] > entries)
+    return -1;
+
+  /* Process as many as were asked for, are queued, and have room
+     for their completions. */
+  cnt = sq_idx[1] - sq_idx[0];
+  if (cnt > to_submit)
+    cnt = to_submit;
+  if (cnt > entries - (cq_idx[1] - cq_idx[0]))
+    cnt = entries - (cq_idx[1] - cq_idx[0]);
+
+  for (done = 0; done < cnt; )
+    {
+      struct ring_sqe sqes[RING_BATCH];
+      struct ring_cqe cqes[RING_BATCH];
+      uint32_t sq_pos = (sq_idx[0] + done) & mask;
+      uint32_t cq_pos = (cq_idx[1] + done) & mask;
+      uint32_t batch = cnt - done;
+      uint32_t i;
+
+      /* Keep the batch contiguous in both rings. */
+      if (batch > RING_BATCH)
+        batch = RING_BATCH;
+      if (batch > entries - sq_pos)
+        batch = entries - sq_pos;
+      if (batch > entries - cq_pos)
+        batch = entries - cq_pos;
+
+      if (!copy_from_user (sqes, &sq->entries[sq_pos],
+                           batch * sizeof *sqes))
+        exit (-1);
+      for (i = 0; i < batch; i++)
+        {
+          bool failed = true;
+
+          cqes[i].user_data = sqes[i].user_data;
+          cqes[i].result = (cancel ? RING_CANCELED
+                            : execute (&sqes[i], &failed));
+          cancel = (sqes[i].flags & RING_LINK) != 0 && failed;
+        }
+      if (!copy_to_user (&cq->entries[cq_pos], cqes, batch * sizeof *cqes))
+        exit (-1);
+      done += batch;
+    }
+
+  /* Publish the new indexes. */
+  sq_idx[0] += cnt;
+  cq_idx[1] += cnt;
+  if (!copy_to_user (&sq->head, &sq_idx[0], sizeof sq_idx[0])
+      || !copy_to_user (&cq->tail, &cq_idx[1], sizeof cq_idx[1]))
+    exit (-1);
+  return cnt;
+}
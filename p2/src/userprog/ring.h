@@ -0,0 +1,10 @@
+#ifndef USERPROG_RING_H
+#define USERPROG_RING_H
+
+#include <ring.h>
+#include <stdbool.h>
+
+bool ring_setup (struct ring_sq *, struct ring_cq *, unsigned entries);
+int ring_enter (unsigned to_submit);
+
+#endif /* userprog/ring.h */
@@ -7,13 +7,17 @@
 #include "threads/vaddr.h"
 #include "threads/malloc.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "userprog/process.h"
+#include "userprog/ring.h"
+#include "userprog/uaccess.h"
 #include "devices/shutdown.h"
 #include "threads/palloc.h"
 #include "threads/malloc.h"
 #include "lib/kernel/stdio.h"
 #include "lib/stdio.h"
 #include "lib/string.h"
+#include "filesys/directory.h"
 #include "filesys/filesys.h"
 #include "filesys/file.h"
 #include "filesys/inode.h"
@@ -21,42 +25,59 @@
 #include "threads/flags.h"
 #include "devices/input.h"
 #include "devices/block.h"
+#include "devices/timer.h"
 
 static void syscall_handler (struct intr_frame *);
-static bool valid_ptr (void *);
+static char *copy_in_string (const char *);
+static bool copy_in_name (char *, const char *);
 
-static struct semaphore filesys_mutex; // Ensure mutual exclusion to filesys
+/* Serializes file system access.  Calls that only read file data
+   or metadata (read, filesize, tell) share it; everything else
+   takes it exclusively. */
+static struct rwlock filesys_rwlock;
 
-const int MAX_OPEN_FILES = 1024; // Max open files per process
+bool procstat_on_exit; // Print statistics at exit (-procstat)
+
+/* Size of the kernel buffers that file names are copied into, on
+   the stack.  Names longer than NAME_MAX cannot name a file. */
+#define NAME_BUF_SIZE (NAME_MAX + 1)
 
 void syscall_init (void)
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
-  sema_init (&filesys_mutex, 1);
+  rwlock_init_named (&filesys_rwlock, "file system");
 }
 
-/* Check if pointers to arguments are valid */
-static int check_args (void *esp, int num_args)
-{
-  int *int_esp = (int *) esp;
-  for (int i = 0; i < num_args; i++)
-    {
-      int_esp += 1;
-      if (!valid_ptr (int_esp))
-        {
-          return 1;
-        }
-    }
-  return 0;
-}
+/* Number of 32-bit arguments each system call takes. */
+static const uint8_t syscall_argc[] = {
+    [SYS_HALT] = 0,     [SYS_EXIT] = 1,     [SYS_EXEC] = 1,
+    [SYS_WAIT] = 1,     [SYS_CREATE] = 2,   [SYS_REMOVE] = 1,
+    [SYS_OPEN] = 1,     [SYS_FILESIZE] = 1, [SYS_READ] = 3,
+    [SYS_WRITE] = 3,    [SYS_SEEK] = 2,     [SYS_TELL] = 1,
+    [SYS_CLOSE] = 1,    [SYS_SYMLINK] = 2,  [SYS_CLOCK_NS] = 0,
+    [SYS_PROCSTAT] = 2, [SYS_NONBLOCK] = 2, [SYS_EXECV] = 2,
+    [SYS_RING_SETUP] = 3, [SYS_RING_ENTER] = 1, [SYS_LOCKSTAT] = 2,
+};
 
 static void syscall_handler (struct intr_frame *f UNUSED)
 {
-  if (!valid_ptr (f->esp))
+  int syscall_num;
+  uint32_t args[3];
+
+  // Fetch the system call number, then all of its arguments in one
+  // copy.  A bad stack pointer makes the copy fail.
+  if (!copy_from_user (&syscall_num, f->esp, sizeof syscall_num))
     {
       exit (-1);
     }
-  int syscall_num = *(int *) f->esp;
+  if (syscall_num >= 0
+      && (size_t) syscall_num < sizeof syscall_argc / sizeof *syscall_argc
+      && !copy_from_user (args, (uint32_t *) f->esp + 1,
+                          syscall_argc[syscall_num] * sizeof *args))
+    {
+      exit (-1);
+    }
+  TRACE (TRACE_SYSCALL_ENTER, syscall_num, 0);
 
   switch (syscall_num)
     {
@@ -64,117 +85,73 @@ static void syscall_handler (struct intr_frame *f UNUSED)
         halt ();
         break;
       case SYS_EXIT:
-        if (check_args (f->esp, 1))
-          {
-            exit (-1);
-          }
-        int status = *((int *) f->esp + 1);
-        exit (status);
+        exit ((int) args[0]);
         break;
       case SYS_EXEC:
-        if (check_args (f->esp, 1))
-          {
-            exit (-1);
-          }
-        char *filename = *((char **) f->esp + 1);
-        f->eax = exec (filename);
+        f->eax = exec ((const char *) args[0]);
         break;
       case SYS_WAIT:
-        if (check_args (f->esp, 1))
-          {
-            exit (-1);
-          }
-        pid_t pid = *((pid_t *) f->esp + 1);
-        f->eax = wait (pid);
+        f->eax = wait ((pid_t) args[0]);
         break;
       case SYS_CREATE:
-        if (check_args (f->esp, 3))
-          {
-            exit (-1);
-          }
-        void *file_c = *((char **) f->esp + 1);
-        unsigned initial_size = *((int *) f->esp + 2);
-        f->eax = create (file_c, initial_size);
+        f->eax = create ((const char *) args[0], args[1]);
         break;
       case SYS_REMOVE:
-        if (check_args (f->esp, 1))
-          {
-            exit (-1);
-          }
-        void *file_r = *((char **) f->esp + 1);
-        f->eax = remove (file_r);
+        f->eax = remove ((const char *) args[0]);
         break;
       case SYS_OPEN:
-        if (check_args (f->esp, 1))
-          {
-            exit (-1);
-          }
-        char *file_o = *((char **) f->esp + 1);
-        f->eax = open (file_o);
+        f->eax = open ((const char *) args[0]);
         break;
       case SYS_FILESIZE:
-        if (check_args (f->esp, 1))
-          {
-            exit (-1);
-          }
-        unsigned fd_f = *((int *) f->esp + 1);
-        f->eax = filesize (fd_f);
+        f->eax = filesize ((int) args[0]);
         break;
       case SYS_READ:
-        if (check_args (f->esp, 3))
-          {
-            exit (-1);
-          }
-        int fd_r = *((int *) f->esp + 1);
-        void *buffer_r = *((char **) f->esp + 2);
-        unsigned size_r = *((int *) f->esp + 3);
-        f->eax = read (fd_r, buffer_r, size_r);
+        f->eax = read ((int) args[0], (void *) args[1], args[2]);
         break;
       case SYS_WRITE:
-        if (check_args (f->esp, 3))
-          {
-            exit (-1);
-          }
-        int fd_w = *((int *) f->esp + 1);
-        void *buffer_w = *((char **) f->esp + 2);
-        unsigned size_w = *((int *) f->esp + 3);
-        f->eax = write (fd_w, buffer_w, size_w);
+        f->eax = write ((int) args[0], (const void *) args[1], args[2]);
         break;
       case SYS_SEEK:
-        if (check_args (f->esp, 2))
-          {
-            exit (-1);
-          }
-        int fd_s = *((int *) f->esp + 1);
-        unsigned position = *((unsigned *) f->esp + 2);
-        seek (fd_s, position);
+        seek ((int) args[0], args[1]);
         break;
       case SYS_TELL:
-        if (check_args (f->esp, 1))
-          {
-            exit (-1);
-          }
-        int fd_t = *((int *) f->esp + 1);
-        f->eax = tell (fd_t);
+        f->eax = tell ((int) args[0]);
         break;
       case SYS_CLOSE:
-        if (check_args (f->esp, 1))
-          {
-            exit (-1);
-          }
-        int fd_c = *((int *) f->esp + 1);
-        close (fd_c);
+        close ((int) args[0]);
         break;
       case SYS_SYMLINK:
-        if (check_args (f->esp, 2))
-          {
-            exit (-1);
-          }
-        char *target = *((char **) f->esp + 1);
-        char *linkpath = *((char **) f->esp + 2);
-        f->eax = symlink (target, linkpath);
+        f->eax = symlink ((char *) args[0], (char *) args[1]);
+        break;
+      case SYS_PROCSTAT:
+        f->eax = procstat ((pid_t) args[0], (struct procstat *) args[1]);
+        break;
+      case SYS_NONBLOCK:
+        f->eax = nonblock ((int) args[0], args[1] != 0);
+        break;
+      case SYS_EXECV:
+        f->eax = execv ((const char *) args[0], (char *const *) args[1]);
+        break;
+      case SYS_RING_SETUP:
+        f->eax = ring_setup ((struct ring_sq *) args[0],
+                             (struct ring_cq *) args[1], args[2]);
+        break;
+      case SYS_RING_ENTER:
+        f->eax = ring_enter (args[0]);
+        break;
+      case SYS_LOCKSTAT:
+        f->eax = lockstat (args[0], args[1] != 0);
+        break;
+      case SYS_CLOCK_NS:
+        {
+          // 64-bit result is returned in EDX:EAX
+          uint64_t ns = clock_ns ();
+          f->eax = (uint32_t) ns;
+          f->edx = (uint32_t) (ns >> 32);
+        }
         break;
     }
+  TRACE (TRACE_SYSCALL_EXIT, syscall_num, f->eax);
 }
 
 void halt () { shutdown_power_off (); }
@@ -182,183 +159,234 @@ void halt () { shutdown_power_off (); }
 void exit (int status)
 {
   printf ("%s: exit(%d)\n", thread_current ()->name, status);
-
-  // Free all of exiting thread's children
-  struct list *our_children = &(thread_current ()->children);
-  if (!list_empty (our_children))
+  if (procstat_on_exit)
     {
-      struct list_elem *curr;
-      for (curr = list_front (our_children); curr != list_end (our_children);)
-        {
-          struct child *curr_item = list_entry (curr, struct child, elem);
-          curr_item->child_thread->parent = NULL;
-          curr = curr->next;
-          free (curr_item);
-        }
+      struct procstat s;
+      thread_get_stats (thread_current ()->tid, &s);
+      printf ("%s: %" PRId64 " user ticks, %" PRId64 " kernel ticks, "
+              "%" PRIu32 " voluntary and %" PRIu32 " involuntary switches, "
+              "%" PRIu64 " us runnable, %" PRIu64 " us blocked\n",
+              thread_current ()->name, s.user_ticks, s.kernel_ticks,
+              s.voluntary_switches, s.involuntary_switches,
+              s.runnable_ns / 1000, s.blocked_ns / 1000);
     }
 
+  // Record exit status for parent; process_exit() reports it
+  if (thread_current ()->process != NULL)
+    thread_current ()->process->exit_status = status;
+
   // Close all open files
-  int fd = 2;
-  struct file **fds = thread_current ()->fd_table;
-  while (fd < MAX_OPEN_FILES)
+  struct fd_table *fds = &thread_current ()->fds;
+  int fd;
+  for (fd = fd_table_next (fds, 0); fd >= 0; fd = fd_table_next (fds, fd + 1))
     {
-      if (fds[fd] != NULL)
-        {
-          close (fd);
-        }
-      fd++;
+      close (fd);
     }
 
-  /* Find current thread in parents children data structure and communicate exit
-  status */
-  if (thread_current ()->parent)
-    {
-      struct list *children = &(thread_current ()->parent->children);
-      if (!list_empty (children))
-        {
-          struct list_elem *curr;
-          struct child *curr_item;
-          for (curr = list_front (children); curr != list_end (children);
-               curr = list_next (curr))
-            {
-              curr_item = list_entry (curr, struct child, elem);
-              if (curr_item->pid == thread_current ()->tid)
-                {
-                  curr_item->exit_status = status;
-                  // Let waiting parent know you are finished
-                  sema_up (&curr_item->exited);
-                  break;
-                }
-            }
-        }
-    }
   // Re-enable writes to executable associated w/ this process
   close (0);
-  palloc_free_page (thread_current ()->fd_table);
+  fd_table_destroy (fds);
   thread_exit ();
 }
 
-pid_t exec (const char *cmd_line)
+// Starts ARGS as a child process and waits for it to load.
+// Returns its pid, or -1 if it could not be started.
+static pid_t start_child (struct exec_args *args)
 {
-  if (!valid_ptr ((void *) cmd_line))
+  int tid = process_execv (args);
+  if (tid == TID_ERROR)
     {
-      exit (-1);
+      return -1;
     }
 
-  int tid = process_execute (cmd_line);
-
   sema_down (&thread_current ()->child_created); // wait for child creation
   tid = !thread_current ()->success ? -1 : tid;  // if exec fails tid = -1
   thread_current ()->success = false;            // reset success value
   return tid;
 }
 
+pid_t exec (const char *cmd_line)
+{
+  char *kcmd_line = copy_in_string (cmd_line);
+  if (kcmd_line == NULL)
+    {
+      return -1;
+    }
+
+  struct exec_args *args = exec_args_parse (kcmd_line);
+  palloc_free_page (kcmd_line);
+  if (args == NULL)
+    {
+      return -1;
+    }
+  return start_child (args);
+}
+
+pid_t execv (const char *path, char *const argv[])
+{
+  char kpath[NAME_BUF_SIZE];
+  if (!copy_in_name (kpath, path))
+    {
+      return -1;
+    }
+  struct exec_args *args = exec_args_create (kpath);
+  if (args == NULL)
+    {
+      return -1;
+    }
+
+  // Copy the argument vector straight into ARGS, one string after
+  // another, stopping at the null pointer that ends it.
+  const char *end = (const char *) args + PGSIZE;
+  const char *uarg;
+  int i;
+  for (i = 0;; i++)
+    {
+      if (!copy_from_user (&uarg, &argv[i], sizeof uarg))
+        {
+          palloc_free_page (args);
+          exit (-1);
+        }
+      if (uarg == NULL)
+        {
+          break;
+        }
+      char *dst = args->argv + args->argv_size;
+      int len = copy_string_from_user (dst, uarg, end - dst);
+      if (len < 0)
+        {
+          palloc_free_page (args);
+          exit (-1);
+        }
+      if (len == end - dst)
+        {
+          palloc_free_page (args); // arguments too long
+          return -1;
+        }
+      args->argc++;
+      args->argv_size += len + 1;
+    }
+  return start_child (args);
+}
+
 int wait (pid_t pid) { return process_wait (pid); }
 
 bool create (const char *file, unsigned initial_size)
 {
-  if (!valid_ptr ((void *) file))
+  char kfile[NAME_BUF_SIZE];
+  if (!copy_in_name (kfile, file))
     {
-      exit (-1);
+      return false;
     }
 
-  sema_down (&filesys_mutex);
-  bool opened = filesys_create (file, initial_size);
-  sema_up (&filesys_mutex);
+  rwlock_acquire_write (&filesys_rwlock);
+  bool opened = filesys_create (kfile, initial_size);
+  rwlock_release_write (&filesys_rwlock);
 
   return opened;
 }
 
 bool remove (const char *file)
 {
-  if (!valid_ptr ((void *) file))
+  char kfile[NAME_BUF_SIZE];
+  if (!copy_in_name (kfile, file))
     {
-      exit (-1);
+      return false;
     }
-  sema_down (&filesys_mutex);
-  bool removed = filesys_remove (file);
-  sema_up (&filesys_mutex);
+  rwlock_acquire_write (&filesys_rwlock);
+  bool removed = filesys_remove (kfile);
+  rwlock_release_write (&filesys_rwlock);
   return removed;
 }
 
 int open (const char *filename)
 {
-  if (!valid_ptr ((void *) filename))
-    {
-      exit (-1);
-    }
-
-  struct file **fds = thread_current ()->fd_table;
-  int fd = 2;
-  struct file *curr = fds[fd];
-
-  // Find open spot in table to open file
-  while (curr != NULL)
+  char kfilename[NAME_BUF_SIZE];
+  if (!copy_in_name (kfilename, filename))
     {
-      curr = fds[++fd];
-      if (fd == MAX_OPEN_FILES)
-        {
-          return -1;
-        }
+      return -1;
     }
 
-  sema_down (&filesys_mutex);
-  struct file *file = filesys_open (filename);
-  sema_up (&filesys_mutex);
+  rwlock_acquire_write (&filesys_rwlock);
+  struct file *file = filesys_open (kfilename);
+  rwlock_release_write (&filesys_rwlock);
   if (file == NULL)
     {
       return -1;
     }
 
-  fds[fd] = file;
+  // Use the lowest free descriptor
+  int fd = fd_table_insert (&thread_current ()->fds, file);
+  if (fd < 0)
+    {
+      rwlock_acquire_write (&filesys_rwlock);
+      file_close (file);
+      rwlock_release_write (&filesys_rwlock);
+    }
   return fd;
 }
 
 int filesize (int fd)
 {
-  struct file *file = thread_current ()->fd_table[fd];
+  struct file *file = fd_table_get (&thread_current ()->fds, fd);
   if (file == NULL)
     {
       return 0;
     }
-  sema_down (&filesys_mutex);
+  rwlock_acquire_read (&filesys_rwlock);
   int length = file_length (file);
-  sema_up (&filesys_mutex);
+  rwlock_release_read (&filesys_rwlock);
   return length;
 }
 
 int read (int fd, void *buffer, unsigned size)
 {
-  if (fd >= MAX_OPEN_FILES || fd == 1 || fd < 0)
+  if (fd == 1 || fd < 0)
     {
       return -1;
     }
-  if (!valid_ptr ((void *) buffer) || !valid_ptr ((char *) buffer + size))
+  if (!check_user_range (buffer, size, true))
     {
       exit (-1);
     }
 
-  struct file *file = thread_current ()->fd_table[fd];
+  struct file *file = fd_table_get (&thread_current ()->fds, fd);
   if (file == NULL)
     {
       return 0;
     }
   unsigned bytes_read = 0;
 
-  // Read from stdin
+  // Read from stdin: whatever is available, waiting only for the
+  // first chunk, and not at all if the process asked not to.
+  // Keys come out of the input buffer with interrupts off, so
+  // they are staged in KBUF rather than copied to user memory.
   if (fd == 0)
     {
-      for (unsigned i = 0; i < size; i++)
+      bool block = !thread_current ()->stdin_nonblock;
+      char kbuf[128];
+      while (bytes_read < size)
         {
-          *((char *) buffer + i) = input_getc ();
-          bytes_read++;
+          size_t n = size - bytes_read;
+          if (n > sizeof kbuf)
+            {
+              n = sizeof kbuf;
+            }
+          n = input_read (kbuf, n, block);
+          if (n == 0)
+            {
+              break;
+            }
+          memcpy ((char *) buffer + bytes_read, kbuf, n);
+          bytes_read += n;
+          block = false;
         }
     }
   else // Read from file
     {
-      sema_down (&filesys_mutex);
+      rwlock_acquire_read (&filesys_rwlock);
       bytes_read = file_read (file, buffer, size);
-      sema_up (&filesys_mutex);
+      rwlock_release_read (&filesys_rwlock);
     }
 
   return bytes_read;
@@ -366,11 +394,11 @@ int read (int fd, void *buffer, unsigned size)
 
 int write (int fd, const void *buffer, unsigned size)
 {
-  if (!valid_ptr ((void *) buffer) || !valid_ptr ((char *) buffer + size))
+  if (!check_user_range (buffer, size, false))
     {
       exit (-1);
     }
-  if (fd >= MAX_OPEN_FILES || fd <= 0)
+  if (fd <= 0)
     {
       return 0;
     }
@@ -380,84 +408,168 @@ int write (int fd, const void *buffer, unsigned size)
       return size;
     }
 
-  struct file *file = thread_current ()->fd_table[fd];
+  struct file *file = fd_table_get (&thread_current ()->fds, fd);
   if (file == NULL || file->deny_write)
     {
       return 0;
     }
 
-  sema_down (&filesys_mutex);
+  rwlock_acquire_write (&filesys_rwlock);
   unsigned bytes_written = file_write (file, buffer, size);
-  sema_up (&filesys_mutex);
+  rwlock_release_write (&filesys_rwlock);
   return bytes_written;
 }
 
 void seek (int fd, unsigned position)
 {
-  if (fd >= MAX_OPEN_FILES || fd == 1)
+  if (fd == 1)
     {
       return;
     }
-  struct file *file = thread_current ()->fd_table[fd];
+  struct file *file = fd_table_get (&thread_current ()->fds, fd);
   if (file == NULL)
     {
       return;
     }
-  sema_down (&filesys_mutex);
+  rwlock_acquire_write (&filesys_rwlock);
   file_seek (file, position);
-  sema_up (&filesys_mutex);
+  rwlock_release_write (&filesys_rwlock);
 }
 
 unsigned tell (int fd)
 {
-  if (fd >= MAX_OPEN_FILES)
-    {
-      return 0;
-    }
-  struct file *file = thread_current ()->fd_table[fd];
+  struct file *file = fd_table_get (&thread_current ()->fds, fd);
   if (file == NULL)
     {
       return 0;
     }
-  sema_down (&filesys_mutex);
+  rwlock_acquire_read (&filesys_rwlock);
   unsigned pos = file_tell (file);
-  sema_up (&filesys_mutex);
+  rwlock_release_read (&filesys_rwlock);
   return pos;
 }
 
 void close (int fd)
 {
-  struct file **fds = thread_current ()->fd_table;
-  if (fd >= MAX_OPEN_FILES)
+  struct file *file = fd_table_remove (&thread_current ()->fds, fd);
+  if (file == NULL)
     {
       return;
     }
-  sema_down (&filesys_mutex);
-  file_close (fds[fd]);
-  fds[fd] = NULL;
-  sema_up (&filesys_mutex);
+  rwlock_acquire_write (&filesys_rwlock);
+  file_close (file);
+  rwlock_release_write (&filesys_rwlock);
 }
 
 int symlink (char *target, char *linkpath)
 {
-  sema_down (&filesys_mutex);
-  struct file *target_file = filesys_open (target);
-  sema_up (&filesys_mutex);
-
-  if (target_file == NULL)
+  char ktarget[NAME_BUF_SIZE];
+  char klinkpath[NAME_BUF_SIZE];
+  if (!copy_in_name (ktarget, target) || !copy_in_name (klinkpath, linkpath))
     {
       return -1;
     }
 
-  sema_down (&filesys_mutex);
-  bool success = filesys_symlink (target, linkpath);
-  sema_up (&filesys_mutex);
+  rwlock_acquire_write (&filesys_rwlock);
+  struct file *target_file = filesys_open (ktarget);
+  rwlock_release_write (&filesys_rwlock);
+
+  bool success = false;
+  if (target_file != NULL)
+    {
+      rwlock_acquire_write (&filesys_rwlock);
+      success = filesys_symlink (ktarget, klinkpath);
+      rwlock_release_write (&filesys_rwlock);
+    }
 
   return success ? 0 : -1;
 }
 
-bool valid_ptr (void *ptr)
+uint64_t clock_ns (void) { return timer_ns (); }
+
+/* Makes reads from FD return 0 at once when no input is
+   available, if NONBLOCKING is true, or wait for input, if it is
+   false.  Only standard input supports this.  Returns true if
+   successful, false if FD is not standard input. */
+bool nonblock (int fd, bool nonblocking)
 {
-  return ptr && !is_kernel_vaddr (ptr) &&
-         pagedir_get_page (thread_current ()->pagedir, ptr);
+  if (fd != 0)
+    {
+      return false;
+    }
+  thread_current ()->stdin_nonblock = nonblocking;
+  return true;
+}
+
+bool procstat (pid_t pid, struct procstat *stats)
+{
+  struct procstat s;
+
+  if (!thread_get_stats (pid, &s))
+    {
+      return false;
+    }
+  if (!copy_to_user (stats, &s, sizeof s))
+    {
+      exit (-1);
+    }
+  return true;
+}
+
+/* Prints the TOP_CNT most waited-on lock names, if TOP_CNT is
+   nonzero, then zeroes the lock statistics, if RESET is true, so
+   that a later call reports only what happened in between.
+   Returns true if successful, false if the kernel was built
+   without LOCKSTAT. */
+bool lockstat (unsigned top_cnt UNUSED, bool reset UNUSED)
+{
+#ifdef LOCKSTAT
+  if (top_cnt > 0)
+    {
+      lockstat_print_stats (top_cnt);
+    }
+  if (reset)
+    {
+      lockstat_reset ();
+    }
+  return true;
+#else
+  return false;
+#endif
+}
+
+/* Copies the file name at user address UNAME into KNAME, which
+   has room for NAME_BUF_SIZE bytes.  Returns true if successful,
+   false if the name is too long to name a file.  Kills the
+   process if the name is not in mapped user memory. */
+static bool copy_in_name (char *kname, const char *uname)
+{
+  int len = copy_string_from_user (kname, uname, NAME_BUF_SIZE);
+  if (len < 0)
+    {
+      exit (-1);
+    }
+  return len < NAME_BUF_SIZE;
+}
+
+/* Copies the null-terminated string at user address USTR into a
+   new page and returns it; the caller must free the page with
+   palloc_free_page().  Kills the process if the string is not
+   entirely in mapped user memory or does not fit in a page.
+   Returns a null pointer if no page is available. */
+static char *copy_in_string (const char *ustr)
+{
+  char *kstr = palloc_get_page (0);
+  if (kstr == NULL)
+    {
+      return NULL;
+    }
+
+  int len = copy_string_from_user (kstr, ustr, PGSIZE);
+  if (len < 0 || len == PGSIZE)
+    {
+      palloc_free_page (kstr);
+      exit (-1);
+    }
+  return kstr;
 }
\ No newline at end of file
@@ -2,6 +2,8 @@
 #define USERPROG_SYSCALL_H
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <procstat.h>
 
 typedef int pid_t;
 void syscall_init (void);
@@ -19,5 +21,14 @@ void seek (int, unsigned);
 unsigned tell (int);
 void close (int);
 int symlink (char *, char *);
+uint64_t clock_ns (void);
+bool procstat (pid_t, struct procstat *);
+bool nonblock (int, bool);
+pid_t execv (const char *, char *const[]);
+bool lockstat (unsigned, bool);
+
+/* Print each process's statistics when it exits?  Set by kernel
+   command-line option "-procstat". */
+extern bool procstat_on_exit;
 
 #endif /* userprog/syscall.h */
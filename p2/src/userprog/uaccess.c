@@ -0,0 +1,116 @@
+#include "userprog/uaccess.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include "threads/interrupt.h"
+#include "threads/vaddr.h"
+
+/* Access to user memory.
+
+   Rather than walk the page directory to check every user
+   pointer before using it, these functions just copy, and let
+   the MMU check.  A copy that touches an unmapped or read-only
+   page faults inside one of the routines in usercopy.S, and
+   page_fault() calls uaccess_fixup(), which makes the routine
+   return failure.  Only the user range's position below
+   PHYS_BASE needs checking in advance, which is cheap. */
+
+/* An instruction in usercopy.S that accesses user memory, and
+   where to resume if it faults. */
+struct usercopy_fixup
+{
+  uintptr_t insn;
+  uintptr_t fixup;
+};
+
+/* Defined in usercopy.S. */
+bool usercopy_copy (void *dst, const void *src, size_t size);
+int usercopy_string (char *dst, const char *src, size_t size);
+extern const struct usercopy_fixup usercopy_fixups[];
+
+/* Returns true if the SIZE bytes starting at user address UADDR
+   all lie below PHYS_BASE. */
+static bool is_user_range (const void *uaddr, size_t size)
+{
+  uintptr_t start = (uintptr_t) uaddr;
+  return start <= (uintptr_t) PHYS_BASE
+         && size <= (uintptr_t) PHYS_BASE - start;
+}
+
+/* Copies SIZE bytes from user address USRC to DST.  Returns true
+   if successful, false if any of the user bytes are not mapped
+   or not in user memory. */
+bool copy_from_user (void *dst, const void *usrc, size_t size)
+{
+  return is_user_range (usrc, size) && usercopy_copy (dst, usrc, size);
+}
+
+/* Copies SIZE bytes from SRC to user address UDST.  Returns true
+   if successful, false if any of the user bytes are not mapped
+   writable or not in user memory. */
+bool copy_to_user (void *udst, const void *src, size_t size)
+{
+  return is_user_range (udst, size) && usercopy_copy (udst, src, size);
+}
+
+/* Copies the null-terminated string at user address USRC into
+   DST, which has room for SIZE bytes.  Returns the string's
+   length, SIZE if the string does not fit, or -1 if it is not
+   entirely in mapped user memory. */
+int copy_string_from_user (char *dst, const char *usrc, size_t size)
+{
+  size_t max = size;
+  int len;
+
+  if ((uintptr_t) usrc >= (uintptr_t) PHYS_BASE)
+    return -1;
+  if (max > (uintptr_t) PHYS_BASE - (uintptr_t) usrc)
+    max = (uintptr_t) PHYS_BASE - (uintptr_t) usrc;
+
+  len = usercopy_string (dst, usrc, max);
+  if (len >= 0 && (size_t) len == max && max < size)
+    {
+      /* Ran into PHYS_BASE without finding the terminator. */
+      return -1;
+    }
+  return len;
+}
+
+/* Returns true if the SIZE bytes starting at user address UADDR
+   are all mapped, and writable as well if WRITE is true.  Touches
+   one byte in each page, so the kernel can then access the range
+   directly, e.g. with file_read(). */
+bool check_user_range (const void *uaddr, size_t size, bool write)
+{
+  const uint8_t *p = uaddr;
+  const uint8_t *end = p + size;
+
+  if (!is_user_range (uaddr, size))
+    return false;
+  while (p < end)
+    {
+      uint8_t byte;
+      if (!usercopy_copy (&byte, p, 1)
+          || (write && !usercopy_copy ((void *) p, &byte, 1)))
+        return false;
+      p = (const uint8_t *) pg_round_down (p) + PGSIZE;
+    }
+  return true;
+}
+
+/* Called by the page fault handler for a fault in kernel mode.
+   If the fault happened in one of the user memory copy routines,
+   arranges for the routine to return failure and returns true.
+   Otherwise returns false. */
+bool uaccess_fixup (struct intr_frame *f)
+{
+  const struct usercopy_fixup *x;
+
+  for (x = usercopy_fixups; x->insn != 0; x++)
+    if (x->insn == (uintptr_t) f->eip)
+      {
+        f->eip = (void (*) (void)) x->fixup;
+        return true;
+      }
+  return false;
+}